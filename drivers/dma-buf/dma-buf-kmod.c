@@ -28,7 +28,98 @@
 __FBSDID("$FreeBSD$");
 
 #include <sys/param.h>
+#include <sys/kernel.h>
 #include <sys/module.h>
+#include <sys/sdt.h>
 
+#include <linux/rcupdate.h>
+
+/*
+ * DTrace provider shared by every drm-kmod module.  This is the lowest
+ * module in the dependency chain so the others only declare it.
+ */
+SDT_PROVIDER_DEFINE(drm);
+
+/*
+ * Polled RCU grace-period cookies, see <linux/rcupdate.h>.
+ *
+ * Taking a cookie starts an asynchronous grace period with call_rcu()
+ * unless one is already in flight, so that cookies also expire for callers
+ * that only ever poll.  Grace periods waited for by cond_synchronize_rcu()
+ * expire cookies as well.
+ */
+static volatile u_long lkpi_rcu_gp_started;
+volatile u_long lkpi_rcu_gp_completed;
+static volatile u_int lkpi_rcu_gp_polling;
+static u_long lkpi_rcu_gp_poll_seq;
+static struct rcu_head lkpi_rcu_gp_poll_head;
+
+static void
+lkpi_rcu_gp_complete(u_long seq)
+{
+	u_long old;
+
+	old = atomic_load_long(&lkpi_rcu_gp_completed);
+	while ((long)(seq - old) > 0 &&
+	    !atomic_fcmpset_rel_long(&lkpi_rcu_gp_completed, &old, seq))
+		;
+}
+
+static void
+lkpi_rcu_gp_poll_cb(struct rcu_head *head __unused)
+{
+	lkpi_rcu_gp_complete(lkpi_rcu_gp_poll_seq);
+	atomic_store_rel_int(&lkpi_rcu_gp_polling, 0);
+}
+
+unsigned long
+lkpi_get_state_synchronize_rcu(void)
+{
+	u_long cookie;
+
+	/* Callers rely on this acting as smp_mb(). */
+	mb();
+	cookie = atomic_load_acq_long(&lkpi_rcu_gp_started);
+	if (atomic_cmpset_int(&lkpi_rcu_gp_polling, 0, 1)) {
+		lkpi_rcu_gp_poll_seq =
+		    atomic_fetchadd_long(&lkpi_rcu_gp_started, 1) + 1;
+		call_rcu(&lkpi_rcu_gp_poll_head, lkpi_rcu_gp_poll_cb);
+	}
+
+	return (cookie);
+}
+
+void
+lkpi_cond_synchronize_rcu(unsigned long cookie)
+{
+	u_long seq;
+
+	if (lkpi_poll_state_synchronize_rcu(cookie))
+		return;
+
+	seq = atomic_fetchadd_long(&lkpi_rcu_gp_started, 1) + 1;
+	synchronize_rcu();
+	lkpi_rcu_gp_complete(seq);
+}
+
+static int
+dmabuf_modevent(module_t mod __unused, int type, void *data __unused)
+{
+	switch (type) {
+	case MOD_UNLOAD:
+		/* Wait for a pending lkpi_rcu_gp_poll_cb(). */
+		rcu_barrier();
+		break;
+	}
+	return (0);
+}
+
+static moduledata_t dmabuf_mod = {
+	"dmabuf",
+	dmabuf_modevent,
+	0
+};
+
+DECLARE_MODULE(dmabuf, dmabuf_mod, SI_SUB_DRIVERS, SI_ORDER_FIRST);
 MODULE_VERSION(dmabuf, 1);
 MODULE_DEPEND(dmabuf, linuxkpi, 1, 1, 1);
@@ -38,9 +38,13 @@ __FBSDID("$FreeBSD$");
 #include <sys/lock.h>
 #include <sys/mutex.h>
 #include <sys/bus.h>
+#include <sys/event.h>
 #include <sys/fcntl.h>
 #include <sys/file.h>
 #include <sys/filio.h>
+#include <sys/poll.h>
+#include <sys/selinfo.h>
+#include <sys/taskqueue.h>
 #include <sys/unistd.h>
 #include <sys/capsicum.h>
 
@@ -51,17 +55,15 @@ __FBSDID("$FreeBSD$");
 
 #include <linux/list.h>
 #include <linux/dma-buf.h>
+#include <linux/dma-fence-unwrap.h>
 #include <linux/dma-resv.h>
+#include <linux/sync_file.h>
 
 #include <uapi/linux/dma-buf.h>
 
 #undef file
 #undef fget
 
-#ifdef NOT_YET
-#define	CONFIG_DMABUF_MOVE_NOTIFY
-#endif
-
 struct db_list {
 	struct list_head head;
 	struct sx lock;
@@ -75,6 +77,7 @@ static fo_stat_t dma_buf_stat;
 static fo_fill_kinfo_t dma_buf_fill_kinfo;
 static fo_mmap_t dma_buf_mmap_fileops;
 static fo_poll_t dma_buf_poll;
+static fo_kqfilter_t dma_buf_kqfilter;
 static fo_seek_t dma_buf_seek;
 static fo_ioctl_t dma_buf_ioctl;
 
@@ -84,6 +87,7 @@ struct fileops dma_buf_fileops  = {
 	.fo_fill_kinfo = dma_buf_fill_kinfo,
 	.fo_mmap = dma_buf_mmap_fileops,
 	.fo_poll = dma_buf_poll,
+	.fo_kqfilter = dma_buf_kqfilter,
 	.fo_seek = dma_buf_seek,
 	.fo_ioctl = dma_buf_ioctl,
 	.fo_flags = DFLAG_PASSABLE|DFLAG_SEEKABLE,
@@ -117,6 +121,10 @@ dma_buf_close(struct file *fp, struct thread *td)
 	if (db->resv == (struct dma_resv *)&db[1])
 		dma_resv_fini(db->resv);
 
+	seldrain(&db->poll_sel);
+	knlist_destroy(&db->poll_sel.si_note);
+	mtx_destroy(&db->poll_lock);
+
 	free(db, M_DMABUF);
 	return (0);
 }
@@ -188,12 +196,237 @@ dma_buf_seek(struct file *fp, off_t offset, int whence, struct thread *td)
 	return (0);
 }
 
+/*
+ * Polling follows Linux: a dma-buf is readable once the fences of its
+ * writers have signaled and writable once all of its fences have.  Each
+ * direction has a callback which, while active, sits on the first fence
+ * found unsignaled and holds a reference on the file.  It runs in fence
+ * signaling context, so the wakeups are left to poll_task.
+ */
+static void
+dma_buf_poll_cb(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct dma_buf_poll_cb_t *dcb = (struct dma_buf_poll_cb_t *)cb;
+	struct dma_buf *db = container_of(dcb->poll, struct dma_buf, poll);
+
+	atomic_store_rel_long(&dcb->active, 0);
+	dma_fence_put(fence);
+	taskqueue_enqueue(taskqueue_thread, &db->poll_task);
+}
+
+/*
+ * Arm the callback of @dcb on the first unsignaled fence that a @write
+ * access has to wait for.  Returns true if there is none.
+ */
+static bool
+dma_buf_poll_arm(struct dma_buf *db, struct dma_buf_poll_cb_t *dcb,
+		 bool write)
+{
+	struct dma_resv_iter cursor;
+	struct dma_fence *fence;
+
+	dma_resv_assert_held(db->resv);
+
+	if (!atomic_cmpset_long(&dcb->active, 0, 1))
+		return (false);
+
+	dma_resv_for_each_fence(&cursor, db->resv, dma_resv_usage_rw(write),
+	    fence) {
+		dma_fence_get(fence);
+		fhold(db->linux_file);
+		if (dma_fence_add_callback(fence, &dcb->cb,
+		    dma_buf_poll_cb) == 0)
+			return (false);
+		fdrop(db->linux_file, curthread);
+		dma_fence_put(fence);
+	}
+
+	atomic_store_rel_long(&dcb->active, 0);
+	return (true);
+}
+
+static void
+dma_buf_poll_task(void *arg, int pending)
+{
+	struct dma_buf *db = arg;
+	struct file *fp = db->linux_file;
+	bool rearm;
+
+	/* Keep knotes posted until all the fences they wait for signaled */
+	mtx_lock(&db->poll_lock);
+	rearm = !knlist_empty(&db->poll_sel.si_note);
+	mtx_unlock(&db->poll_lock);
+	if (rearm) {
+		dma_resv_lock(db->resv, NULL);
+		dma_buf_poll_arm(db, &db->cb_excl, false);
+		dma_buf_poll_arm(db, &db->cb_shared, true);
+		dma_resv_unlock(db->resv);
+	}
+
+	mtx_lock(&db->poll_lock);
+	selwakeup(&db->poll_sel);
+	KNOTE_LOCKED(&db->poll_sel.si_note, 0);
+	mtx_unlock(&db->poll_lock);
+
+	/*
+	 * Drop the file references of the callbacks that ran and of the
+	 * filters that asked for arming, db may go
+	 */
+	while (pending-- > 0)
+		fdrop(fp, curthread);
+}
+
 static int
 dma_buf_poll(struct file *fp, int events,
 	     struct ucred *active_cred, struct thread *td)
 {
-	// TODO: implement this when we need it (mostly used for cross-device fence sync)
-	return (ENOTSUP);
+	struct dma_buf *db;
+	int revents;
+
+	if (!fp_is_db(fp))
+		return (POLLNVAL);
+
+	db = fp->f_data;
+	events &= POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM;
+	if (events == 0)
+		return (0);
+
+	for (;;) {
+		revents = 0;
+		dma_resv_lock(db->resv, NULL);
+		if ((events & (POLLOUT | POLLWRNORM)) != 0 &&
+		    dma_buf_poll_arm(db, &db->cb_shared, true))
+			revents |= events & (POLLOUT | POLLWRNORM);
+		if ((events & (POLLIN | POLLRDNORM)) != 0 &&
+		    dma_buf_poll_arm(db, &db->cb_excl, false))
+			revents |= events & (POLLIN | POLLRDNORM);
+		dma_resv_unlock(db->resv);
+		if (revents != 0)
+			return (revents);
+
+		/*
+		 * The callbacks only sit on the first unsignaled fence, so
+		 * one that ran since it was armed says nothing about the
+		 * others: look at all of them again.  A callback still
+		 * active under poll_lock has its wakeup ordered after
+		 * selrecord().
+		 */
+		mtx_lock(&db->poll_lock);
+		if ((events & (POLLOUT | POLLWRNORM)) != 0 &&
+		    dma_resv_test_signaled(db->resv, dma_resv_usage_rw(true)))
+			revents |= events & (POLLOUT | POLLWRNORM);
+		if ((events & (POLLIN | POLLRDNORM)) != 0 &&
+		    dma_resv_test_signaled(db->resv, dma_resv_usage_rw(false)))
+			revents |= events & (POLLIN | POLLRDNORM);
+		if (revents == 0 &&
+		    ((events & (POLLOUT | POLLWRNORM)) == 0 ||
+		    db->cb_shared.active != 0) &&
+		    ((events & (POLLIN | POLLRDNORM)) == 0 ||
+		    db->cb_excl.active != 0)) {
+			selrecord(td, &db->poll_sel);
+			mtx_unlock(&db->poll_lock);
+			return (0);
+		}
+		mtx_unlock(&db->poll_lock);
+		if (revents != 0)
+			return (revents);
+		/* A callback ran but newer fences are pending, arm again */
+	}
+}
+
+static void
+filt_dma_buf_detach(struct knote *kn)
+{
+	struct dma_buf *db = kn->kn_hook;
+
+	knlist_remove(&db->poll_sel.si_note, kn, 0);
+}
+
+/*
+ * Fences can be added after the callback of a knote ran, e.g. for the next
+ * frame.  When the filter finds the buffer busy with no callback armed,
+ * have poll_task arm one, the reservation lock can't be taken under the
+ * knlist mutex.  The enqueue holds a file reference like the callbacks do.
+ */
+static int
+filt_dma_buf_event(struct knote *kn, struct dma_buf_poll_cb_t *dcb,
+    bool write)
+{
+	struct dma_buf *db = kn->kn_hook;
+
+	if (dma_resv_test_signaled(db->resv, dma_resv_usage_rw(write)))
+		return (1);
+	if (atomic_load_acq_long(&dcb->active) == 0) {
+		fhold(db->linux_file);
+		taskqueue_enqueue(taskqueue_thread, &db->poll_task);
+	}
+	return (0);
+}
+
+static int
+filt_dma_buf_read(struct knote *kn, long hint)
+{
+	struct dma_buf *db = kn->kn_hook;
+
+	return (filt_dma_buf_event(kn, &db->cb_excl, false));
+}
+
+static int
+filt_dma_buf_write(struct knote *kn, long hint)
+{
+	struct dma_buf *db = kn->kn_hook;
+
+	return (filt_dma_buf_event(kn, &db->cb_shared, true));
+}
+
+static struct filterops dma_buf_read_filtops = {
+	.f_isfd = 1,
+	.f_detach = filt_dma_buf_detach,
+	.f_event = filt_dma_buf_read,
+};
+
+static struct filterops dma_buf_write_filtops = {
+	.f_isfd = 1,
+	.f_detach = filt_dma_buf_detach,
+	.f_event = filt_dma_buf_write,
+};
+
+static int
+dma_buf_kqfilter(struct file *fp, struct knote *kn)
+{
+	struct dma_buf *db;
+	struct dma_buf_poll_cb_t *dcb;
+	bool write;
+
+	if (!fp_is_db(fp))
+		return (EINVAL);
+
+	db = fp->f_data;
+
+	switch (kn->kn_filter) {
+	case EVFILT_READ:
+		kn->kn_fop = &dma_buf_read_filtops;
+		dcb = &db->cb_excl;
+		write = false;
+		break;
+	case EVFILT_WRITE:
+		kn->kn_fop = &dma_buf_write_filtops;
+		dcb = &db->cb_shared;
+		write = true;
+		break;
+	default:
+		return (EINVAL);
+	}
+
+	kn->kn_hook = db;
+	knlist_add(&db->poll_sel.si_note, kn, 0);
+
+	/* Have poll_task post the knote once the fences signal */
+	dma_resv_lock(db->resv, NULL);
+	dma_buf_poll_arm(db, dcb, write);
+	dma_resv_unlock(db->resv);
+
+	return (0);
 }
 
 
@@ -216,6 +449,95 @@ dma_buf_end_cpu_access(struct dma_buf *db, enum dma_data_direction dir)
 	return (0);
 }
 
+/*
+ * Return a sync_file fd with the fences that a DMA_BUF_SYNC_READ and/or
+ * DMA_BUF_SYNC_WRITE access would implicitly wait for.
+ */
+static int
+dma_buf_export_sync_file(struct dma_buf *db,
+			 struct dma_buf_export_sync_file *arg)
+{
+	enum dma_resv_usage usage;
+	struct dma_fence *fence = NULL;
+	struct sync_file *sync_file;
+	int fd, rc;
+
+	if ((arg->flags & ~DMA_BUF_SYNC_RW) != 0 ||
+	    (arg->flags & DMA_BUF_SYNC_RW) == 0)
+		return (EINVAL);
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0)
+		return (-fd);
+
+	usage = dma_resv_usage_rw(arg->flags & DMA_BUF_SYNC_WRITE);
+	rc = dma_resv_get_singleton(db->resv, usage, &fence);
+	if (rc != 0)
+		goto err_put_fd;
+
+	if (fence == NULL)
+		fence = dma_fence_get_stub();
+
+	sync_file = sync_file_create(fence);
+	dma_fence_put(fence);
+	if (sync_file == NULL) {
+		rc = -ENOMEM;
+		goto err_put_fd;
+	}
+
+	/* The fd is copied out after we return */
+	fd_install(fd, sync_file->file);
+	arg->fd = fd;
+	return (0);
+
+err_put_fd:
+	put_unused_fd(fd);
+	return (-rc);
+}
+
+/*
+ * Add the fences of a sync_file to the reservation object, as readers or
+ * as writers according to the flags, for implicit sync users to wait on.
+ */
+static int
+dma_buf_import_sync_file(struct dma_buf *db,
+			 struct dma_buf_import_sync_file *arg)
+{
+	struct dma_fence *fence, *f;
+	enum dma_resv_usage usage;
+	struct dma_fence_unwrap iter;
+	unsigned int num_fences;
+	int rc = 0;
+
+	if ((arg->flags & ~DMA_BUF_SYNC_RW) != 0 ||
+	    (arg->flags & DMA_BUF_SYNC_RW) == 0)
+		return (EINVAL);
+
+	fence = sync_file_get_fence(arg->fd);
+	if (fence == NULL)
+		return (EINVAL);
+
+	usage = (arg->flags & DMA_BUF_SYNC_WRITE) ? DMA_RESV_USAGE_WRITE :
+	    DMA_RESV_USAGE_READ;
+
+	num_fences = 0;
+	dma_fence_unwrap_for_each(f, &iter, fence)
+		++num_fences;
+
+	if (num_fences > 0) {
+		dma_resv_lock(db->resv, NULL);
+		rc = dma_resv_reserve_fences(db->resv, num_fences);
+		if (rc == 0) {
+			dma_fence_unwrap_for_each(f, &iter, fence)
+				dma_resv_add_fence(db->resv, f, usage);
+		}
+		dma_resv_unlock(db->resv);
+	}
+
+	dma_fence_put(fence);
+	return (-rc);
+}
+
 static int
 dma_buf_ioctl(struct file *fp, u_long com, void *data,
 	      struct ucred *active_cred, struct thread *td)
@@ -255,6 +577,10 @@ dma_buf_ioctl(struct file *fp, u_long com, void *data,
 		else
 			rc = dma_buf_begin_cpu_access(db, dir);
 		return (-rc);
+	case DMA_BUF_IOCTL_EXPORT_SYNC_FILE:
+		return (dma_buf_export_sync_file(db, data));
+	case DMA_BUF_IOCTL_IMPORT_SYNC_FILE:
+		return (dma_buf_import_sync_file(db, data));
 	default:
 		return (ENOTTY);
 	}
@@ -298,21 +624,27 @@ dma_buf_dynamic_attach(struct dma_buf *db, struct device *dev,
 	list_add(&dba->node, &db->attachments);
 	dma_resv_unlock(db->resv);
 
-	if ((iops != NULL) != (db->ops->pin != NULL)) {
-		if (dba->dmabuf->ops->pin != NULL) {
+	/*
+	 * Only dynamic importers of dynamic exporters map lazily and get
+	 * move_notify() calls.  Every other combination is mapped here once
+	 * and, for a dynamic exporter, pinned until detach.
+	 */
+	if (dma_buf_attachment_is_dynamic(dba) != dma_buf_is_dynamic(db)) {
+		if (dma_buf_is_dynamic(db)) {
 			dma_resv_lock(dba->dmabuf->resv, NULL);
 			rc = dma_buf_pin(dba);
 			if (rc != 0) {
 				dma_resv_unlock(dba->dmabuf->resv);
+				dma_buf_detach(db, dba);
 				return (ERR_PTR(rc));
 			}
 		}
 		sgt = db->ops->map_dma_buf(dba, DMA_BIDIRECTIONAL);
 		if (sgt == NULL)
 			sgt = ERR_PTR(-ENOMEM);
-		if (IS_ERR(sgt) && dba->dmabuf->ops->pin != NULL)
+		if (IS_ERR(sgt) && dma_buf_is_dynamic(db))
 			dma_buf_unpin(dba);
-		if (dba->dmabuf->ops->pin != NULL)
+		if (dma_buf_is_dynamic(db))
 			dma_resv_unlock(dba->dmabuf->resv);
 		if (IS_ERR(sgt)) {
 			dma_buf_detach(db, dba);
@@ -341,10 +673,10 @@ dma_buf_detach(struct dma_buf *db, struct dma_buf_attachment *dba)
 		return;
 
 	if (dba->sgt != NULL) {
-		if (dba->dmabuf->ops->pin != NULL)
+		if (dma_buf_is_dynamic(db))
 			dma_resv_lock(dba->dmabuf->resv, NULL);
 		db->ops->unmap_dma_buf(dba, dba->sgt, dba->dir);
-		if (dba->dmabuf->ops->pin != NULL) {
+		if (dma_buf_is_dynamic(db)) {
 			dma_buf_unpin(dba);
 			dma_resv_unlock(dba->dmabuf->resv);
 		}
@@ -457,6 +789,9 @@ dma_buf_export(const struct dma_buf_export_info *exp_info)
 		goto err;
 
 	finit(fp, 0, DTYPE_DMABUF, db, &dma_buf_fileops);
+	mtx_init(&db->poll_lock, "dmabufpoll", NULL, MTX_DEF);
+	knlist_init_mtx(&db->poll_sel.si_note, &db->poll_lock);
+	TASK_INIT(&db->poll_task, 0, dma_buf_poll_task, db);
 
 	db->linux_file = fp;
 	mutex_init(&db->lock);
@@ -476,7 +811,9 @@ struct sg_table *
 dma_buf_map_attachment(struct dma_buf_attachment *dba, enum dma_data_direction dir)
 {
 	struct sg_table *sgt;
+#ifndef CONFIG_DMABUF_MOVE_NOTIFY
 	int rc;
+#endif
 
 	MPASS(dba != NULL);
 	MPASS(dba->dmabuf != NULL);
@@ -484,7 +821,7 @@ dma_buf_map_attachment(struct dma_buf_attachment *dba, enum dma_data_direction d
 	if (dba == NULL || dba->dmabuf == NULL)
 		return (ERR_PTR(-EINVAL));
 
-	if (dba->importer_ops != NULL)
+	if (dma_buf_attachment_is_dynamic(dba))
 		dma_resv_assert_held(dba->dmabuf->resv);
 
 	if (dba->sgt != NULL) {
@@ -493,7 +830,7 @@ dma_buf_map_attachment(struct dma_buf_attachment *dba, enum dma_data_direction d
 		return (dba->sgt);
 	}
 
-	if (dba->dmabuf->ops->pin != NULL) {
+	if (dma_buf_is_dynamic(dba->dmabuf)) {
 		dma_resv_assert_held(dba->dmabuf->resv);
 #ifndef CONFIG_DMABUF_MOVE_NOTIFY
 		rc = dma_buf_pin(dba);
@@ -507,7 +844,7 @@ dma_buf_map_attachment(struct dma_buf_attachment *dba, enum dma_data_direction d
 		return (ERR_PTR(-ENOMEM));
 
 #ifndef CONFIG_DMABUF_MOVE_NOTIFY
-	if (IS_ERR(sgt) && dba->dmabuf->ops->pin != NULL)
+	if (IS_ERR(sgt) && dma_buf_is_dynamic(dba->dmabuf))
 		dma_buf_unpin(dba);
 #endif
 
@@ -531,17 +868,17 @@ dma_buf_unmap_attachment(struct dma_buf_attachment *dba,
 	if (dba == NULL || dba->dmabuf == NULL || sg_table == NULL)
 		return;
 
-	if (dba->importer_ops != NULL)
+	if (dma_buf_attachment_is_dynamic(dba))
 		dma_resv_assert_held(dba->dmabuf->resv);
 	if (dba->sgt == sg_table)
 		return;
-	if (dba->dmabuf->ops->pin != NULL)
+	if (dma_buf_is_dynamic(dba->dmabuf))
 		dma_resv_assert_held(dba->dmabuf->resv);
 
 	dba->dmabuf->ops->unmap_dma_buf(dba, sg_table, dir);
 
 #ifndef CONFIG_DMABUF_MOVE_NOTIFY
-	if (dba->dmabuf->ops->pin != NULL)
+	if (dma_buf_is_dynamic(dba->dmabuf))
 		dma_buf_unpin(dba);
 #endif
 }
@@ -553,9 +890,13 @@ dma_buf_move_notify(struct dma_buf *db)
 
 	dma_resv_assert_held(db->resv);
 
+	/*
+	 * Importers drop their mappings here and map again under the
+	 * reservation lock on next use, after waiting for the fences of the
+	 * move.  Non-dynamic attachments hold a pin and never see a move.
+	 */
 	list_for_each_entry(dba, &db->attachments, node)
-		if (dba->importer_ops != NULL &&
-		    dba->importer_ops->move_notify != NULL)
+		if (dma_buf_attachment_is_dynamic(dba))
 			dba->importer_ops->move_notify(dba);
 }
 
@@ -24,11 +24,26 @@
  *
  */
 
+#include <sys/sdt.h>
+
 #include <linux/dma-fence.h>
 #include <linux/seq_file.h>
 
+#include <trace/events/dma_fence.h>
+
 MALLOC_DECLARE(M_DMABUF);
 
+#define	DMA_FENCE_SDT_PROBE_DEFINE(name)				\
+	SDT_PROBE_DEFINE5(drm, dma_fence, , name, "struct dma_fence *",	\
+	    "char *", "char *", "uint64_t", "uint64_t")
+
+DMA_FENCE_SDT_PROBE_DEFINE(init);
+DMA_FENCE_SDT_PROBE_DEFINE(destroy);
+DMA_FENCE_SDT_PROBE_DEFINE(enable_signal);
+DMA_FENCE_SDT_PROBE_DEFINE(signaled);
+DMA_FENCE_SDT_PROBE_DEFINE(wait_start);
+DMA_FENCE_SDT_PROBE_DEFINE(wait_end);
+
 static struct dma_fence dma_fence_stub;
 static DEFINE_SPINLOCK(dma_fence_stub_lock);
 
@@ -114,6 +129,7 @@ dma_fence_signal_timestamp_locked(struct dma_fence *fence,
 
 	fence->timestamp = timestamp;
 	set_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &fence->flags);
+	trace_dma_fence_signaled(fence);
 
 	list_for_each_entry_safe(cur, tmp, &cb_list, node) {
 		INIT_LIST_HEAD(&cur->node);
@@ -179,10 +195,12 @@ dma_fence_wait_timeout(struct dma_fence *fence, bool intr, signed long timeout)
 
 	dma_fence_enable_sw_signaling(fence);
 
+	trace_dma_fence_wait_start(fence);
 	if (fence->ops && fence->ops->wait != NULL)
 		rv = fence->ops->wait(fence, intr, timeout);
 	else
 		rv = dma_fence_default_wait(fence, intr, timeout);
+	trace_dma_fence_wait_end(fence);
 	return (rv);
 }
 
@@ -195,6 +213,7 @@ dma_fence_release(struct kref *kref)
 	struct dma_fence *fence;
 
 	fence = container_of(kref, struct dma_fence, refcount);
+	trace_dma_fence_destroy(fence);
 	if (fence->ops && fence->ops->release)
 		fence->ops->release(fence);
 	else
@@ -226,6 +245,7 @@ dma_fence_enable_sw_signaling(struct dma_fence *fence)
 		goto out;
 	if (was_enabled == false &&
 	    fence->ops && fence->ops->enable_signaling) {
+		trace_dma_fence_enable_signal(fence);
 		if (fence->ops->enable_signaling(fence) == false)
 			dma_fence_signal_locked(fence);
 	}
@@ -465,6 +485,7 @@ dma_fence_init(struct dma_fence *fence, const struct dma_fence_ops *ops,
 	fence->seqno = seqno;
 	fence->flags = 0;
 	fence->error = 0;
+	trace_dma_fence_init(fence);
 }
 
 /*
@@ -1190,6 +1190,56 @@ void amdgpu_device_wb_free(struct amdgpu_device *adev, u32 wb)
 		__clear_bit(wb, adev->wb.used);
 }
 
+#ifdef __FreeBSD__
+/*
+ * Resizable BAR capability registers. The capability holds a pair of them
+ * for each resizable BAR, 8 bytes apart.
+ */
+#define	AMDGPU_REBAR_CAP		0x04
+#define	AMDGPU_REBAR_CAP_SIZES_SHIFT	4
+#define	AMDGPU_REBAR_CTRL		0x08
+#define	AMDGPU_REBAR_CTRL_BAR_IDX	0x00000007
+#define	AMDGPU_REBAR_CTRL_NBAR_MASK	0x000000e0
+#define	AMDGPU_REBAR_CTRL_NBAR_SHIFT	5
+#define	AMDGPU_REBAR_CTRL_BAR_SIZE	0x00003f00
+#define	AMDGPU_REBAR_CTRL_BAR_SHIFT	8
+
+/*
+ * Return the offset of the resizable BAR registers of @bar, relative to
+ * which AMDGPU_REBAR_CAP and AMDGPU_REBAR_CTRL are, or 0 if it has none.
+ */
+static int amdgpu_device_rebar_find(device_t dev, int bar)
+{
+	int pos, i, nbars;
+	u32 ctrl;
+
+	if (pci_find_extcap(dev, PCIZ_RESIZE_BAR, &pos))
+		return 0;
+
+	ctrl = pci_read_config(dev, pos + AMDGPU_REBAR_CTRL, 4);
+	nbars = (ctrl & AMDGPU_REBAR_CTRL_NBAR_MASK) >>
+		AMDGPU_REBAR_CTRL_NBAR_SHIFT;
+	for (i = 0; i < nbars; ++i, pos += 8) {
+		ctrl = pci_read_config(dev, pos + AMDGPU_REBAR_CTRL, 4);
+		if ((ctrl & AMDGPU_REBAR_CTRL_BAR_IDX) == bar)
+			return pos;
+	}
+
+	return 0;
+}
+
+/* Set the size of a BAR to 1MB << @size */
+static void amdgpu_device_rebar_set(device_t dev, int pos, int size)
+{
+	u32 ctrl;
+
+	ctrl = pci_read_config(dev, pos + AMDGPU_REBAR_CTRL, 4);
+	ctrl &= ~AMDGPU_REBAR_CTRL_BAR_SIZE;
+	ctrl |= size << AMDGPU_REBAR_CTRL_BAR_SHIFT;
+	pci_write_config(dev, pos + AMDGPU_REBAR_CTRL, ctrl, 4);
+}
+#endif
+
 /**
  * amdgpu_device_resize_fb_bar - try to resize FB BAR
  *
@@ -1202,7 +1252,87 @@ void amdgpu_device_wb_free(struct amdgpu_device *adev, u32 wb)
 int amdgpu_device_resize_fb_bar(struct amdgpu_device *adev)
 {
 #ifdef __FreeBSD__
-	// BSDFIXME
+	/*
+	 * The FreeBSD PCI bus driver can't resize BARs, so do it by hand: drop
+	 * the BAR resources, program the new size and have LinuxKPI reserve
+	 * them again, which sizes them anew.  Only pci_resource_start()
+	 * reserves a BAR that has no resource list entry, through
+	 * linux_pci_get_bar(pdev, bar, true) and pci_reserve_map() in
+	 * compat/linuxkpi/common/src/linux_pci.c; pci_resource_len() only
+	 * looks it up.
+	 */
+	device_t dev = device_get_parent(adev->pdev->dev.bsddev);
+	int rbar_size, old_size, pos;
+	u32 sizes;
+	u16 cmd;
+	int r;
+
+	/* Bypass for VF */
+	if (amdgpu_sriov_vf(adev))
+		return 0;
+
+	/* skip if the bios has already enabled large BAR */
+	if (adev->gmc.real_vram_size &&
+	    (pci_resource_len(adev->pdev, 0) >= adev->gmc.real_vram_size))
+		return 0;
+
+	pos = amdgpu_device_rebar_find(dev, 0);
+	if (!pos)
+		return 0;
+
+	/* Limit the BAR size to what is available */
+	rbar_size = max(order_base_2(adev->gmc.real_vram_size) - 20, 0);
+	sizes = pci_read_config(dev, pos + AMDGPU_REBAR_CAP, 4) >>
+		AMDGPU_REBAR_CAP_SIZES_SHIFT;
+	sizes &= GENMASK(min(rbar_size, 27), 0);
+	if (!sizes)
+		return 0;
+	rbar_size = fls(sizes) - 1;
+
+	old_size = (pci_read_config(dev, pos + AMDGPU_REBAR_CTRL, 4) &
+		    AMDGPU_REBAR_CTRL_BAR_SIZE) >> AMDGPU_REBAR_CTRL_BAR_SHIFT;
+	if (rbar_size <= old_size)
+		return 0;
+
+	/* Disable memory decoding while we change the BAR addresses and size */
+	cmd = pci_read_config(dev, PCIR_COMMAND, 2);
+	pci_write_config(dev, PCIR_COMMAND, cmd & ~PCIM_CMD_MEMEN, 2);
+
+	/* The BAR can't be moved while something has it allocated */
+	bus_delete_resource(dev, SYS_RES_MEMORY, PCIR_BAR(0));
+	if (bus_get_resource_count(dev, SYS_RES_MEMORY, PCIR_BAR(0))) {
+		pci_write_config(dev, PCIR_COMMAND, cmd, 2);
+		return 0;
+	}
+
+	/* Free the doorbell BAR as well, we most likely need to move both. */
+	amdgpu_device_doorbell_fini(adev);
+	if (adev->asic_type >= CHIP_BONAIRE)
+		bus_delete_resource(dev, SYS_RES_MEMORY, PCIR_BAR(2));
+
+	amdgpu_device_rebar_set(dev, pos, rbar_size);
+	pci_resource_start(adev->pdev, 0);
+	if (!pci_resource_len(adev->pdev, 0)) {
+		DRM_INFO("Not enough PCI address space for a large BAR.");
+		amdgpu_device_rebar_set(dev, pos, old_size);
+		pci_resource_start(adev->pdev, 0);
+	}
+
+	/* pci_resource_flags() in doorbell_init() doesn't reserve either. */
+	if (adev->asic_type >= CHIP_BONAIRE)
+		pci_resource_start(adev->pdev, 2);
+
+	/* When the doorbell or fb BAR isn't available we have no chance of
+	 * using the device.
+	 */
+	r = amdgpu_device_doorbell_init(adev);
+	if (r || !pci_resource_len(adev->pdev, 0)) {
+		pci_write_config(dev, PCIR_COMMAND, cmd, 2);
+		return -ENODEV;
+	}
+
+	pci_write_config(dev, PCIR_COMMAND, cmd, 2);
+
 	return 0;
 #else
 	int rbar_size = pci_rebar_bytes_to_size(adev->gmc.real_vram_size);
@@ -2339,7 +2469,7 @@ static int amdgpu_device_init_schedulers(struct amdgpu_device *adev)
 				   ring->num_hw_submission, amdgpu_job_hang_limit,
 				   timeout, adev->reset_domain->wq,
 				   ring->sched_score, ring->name,
-				   adev->dev);
+				   adev->dev, DRM_SCHED_POLICY_DEFAULT);
 		if (r) {
 			DRM_ERROR("Failed to create scheduler on ring %s.\n",
 				  ring->name);
@@ -3504,6 +3634,90 @@ static void amdgpu_device_check_iommu_direct_map(struct amdgpu_device *adev)
 		adev->ram_is_direct_mapped = true;
 }
 
+#ifdef __FreeBSD__
+#ifndef PCI_EXP_DEVCAP2_ATOMIC_ROUTE
+#define	PCI_EXP_DEVCAP2_ATOMIC_ROUTE	0x00000040
+#define	PCI_EXP_DEVCAP2_ATOMIC_COMP32	0x00000080
+#define	PCI_EXP_DEVCAP2_ATOMIC_COMP64	0x00000100
+#define	PCI_EXP_DEVCTL2_ATOMIC_REQ	0x0040
+#define	PCI_EXP_DEVCTL2_ATOMIC_EGRESS_BLOCK	0x0080
+#endif
+
+/**
+ * amdgpu_device_enable_atomics_to_root - enable AtomicOp requests
+ *
+ * @adev: amdgpu_device pointer
+ * @cap_mask: AtomicOp completer capabilities the root port must have
+ *
+ * The FreeBSD counterpart of pci_enable_atomic_ops_to_root(): check that
+ * every switch port on the way up routes AtomicOps without blocking them
+ * and that the root port completes all the sizes in @cap_mask, then let
+ * the GPU issue AtomicOp requests.
+ *
+ * Returns true if AtomicOps were enabled.
+ */
+static bool amdgpu_device_enable_atomics_to_root(struct amdgpu_device *adev,
+						 u32 cap_mask)
+{
+	device_t dev = device_get_parent(adev->pdev->dev.bsddev);
+	device_t bridge;
+	u32 cap, ctl2;
+	int type;
+
+	if (pci_find_cap(dev, PCIY_EXPRESS, NULL))
+		return false;
+
+	/* Only endpoints as requesters and root ports as completers */
+	type = pcie_read_config(dev, PCIER_FLAGS, 2) & PCIEM_FLAGS_TYPE;
+	switch (type) {
+	case PCIEM_TYPE_ENDPOINT:
+	case PCIEM_TYPE_LEGACY_ENDPOINT:
+	case PCIEM_TYPE_ROOT_INT_EP:
+		break;
+	default:
+		return false;
+	}
+
+	/* Walk the bridges up to the host bridge, which is no PCI device */
+	for (bridge = device_get_parent(device_get_parent(dev));
+	     device_get_devclass(device_get_parent(bridge)) ==
+	     devclass_find("pci");
+	     bridge = device_get_parent(device_get_parent(bridge))) {
+		if (pci_find_cap(bridge, PCIY_EXPRESS, NULL))
+			return false;
+
+		cap = pcie_read_config(bridge, PCIER_DEVICE_CAP2, 4);
+		type = pcie_read_config(bridge, PCIER_FLAGS, 2) &
+		       PCIEM_FLAGS_TYPE;
+		switch (type) {
+		/* Ensure switch ports support AtomicOp routing */
+		case PCIEM_TYPE_UPSTREAM_PORT:
+		case PCIEM_TYPE_DOWNSTREAM_PORT:
+			if (!(cap & PCI_EXP_DEVCAP2_ATOMIC_ROUTE))
+				return false;
+			break;
+		/* Ensure root port supports all the sizes we care about */
+		case PCIEM_TYPE_ROOT_PORT:
+			if ((cap & cap_mask) != cap_mask)
+				return false;
+			break;
+		}
+
+		/* Ensure upstream ports don't block AtomicOps on egress */
+		if (type == PCIEM_TYPE_UPSTREAM_PORT) {
+			ctl2 = pcie_read_config(bridge, PCIER_DEVICE_CTL2, 2);
+			if (ctl2 & PCI_EXP_DEVCTL2_ATOMIC_EGRESS_BLOCK)
+				return false;
+		}
+	}
+
+	pcie_adjust_config(dev, PCIER_DEVICE_CTL2, PCI_EXP_DEVCTL2_ATOMIC_REQ,
+			   PCI_EXP_DEVCTL2_ATOMIC_REQ, 2);
+
+	return true;
+}
+#endif
+
 static const struct attribute *amdgpu_dev_attributes[] = {
 	&dev_attr_product_name.attr,
 	&dev_attr_product_number.attr,
@@ -3701,21 +3915,22 @@ int amdgpu_device_init(struct amdgpu_device *adev,
 			return r;
 	}
 
-#ifdef __linux__
-	// XXX: Don't need this, driver will fallback to MMIO
-	// See: amdgpu_atombios_init()
 	/* enable PCIE atomic ops */
 	if (amdgpu_sriov_vf(adev))
 		adev->have_atomics_support = ((struct amd_sriov_msg_pf2vf_info *)
 			adev->virt.fw_reserve.p_pf2vf)->pcie_atomic_ops_support_flags ==
 			(PCI_EXP_DEVCAP2_ATOMIC_COMP32 | PCI_EXP_DEVCAP2_ATOMIC_COMP64);
 	else
+#ifdef __linux__
 		adev->have_atomics_support =
 			!pci_enable_atomic_ops_to_root(adev->pdev,
 					  PCI_EXP_DEVCAP2_ATOMIC_COMP32 |
 					  PCI_EXP_DEVCAP2_ATOMIC_COMP64);
 #elif defined(__FreeBSD__)
-	adev->have_atomics_support = false;
+		adev->have_atomics_support =
+			amdgpu_device_enable_atomics_to_root(adev,
+					  PCI_EXP_DEVCAP2_ATOMIC_COMP32 |
+					  PCI_EXP_DEVCAP2_ATOMIC_COMP64);
 #endif
 	if (!adev->have_atomics_support)
 		dev_info(adev->dev, "PCIE atomic ops is not supported\n");
@@ -283,6 +283,22 @@ static void amdgpu_restore_msix(struct amdgpu_device *adev)
 	pci_write_config_word(adev->pdev, adev->pdev->msix_cap + PCI_MSIX_FLAGS, ctrl);
 }
 
+#ifdef __FreeBSD__
+/* Wait for and destroy the workqueues of the secondary IH rings */
+static void amdgpu_irq_destroy_wqs(struct amdgpu_device *adev)
+{
+	if (adev->irq.ih1_wq)
+		destroy_workqueue(adev->irq.ih1_wq);
+	if (adev->irq.ih2_wq)
+		destroy_workqueue(adev->irq.ih2_wq);
+	if (adev->irq.ih_soft_wq)
+		destroy_workqueue(adev->irq.ih_soft_wq);
+	adev->irq.ih1_wq = NULL;
+	adev->irq.ih2_wq = NULL;
+	adev->irq.ih_soft_wq = NULL;
+}
+#endif
+
 /**
  * amdgpu_irq_init - initialize interrupt handling
  *
@@ -305,7 +321,6 @@ int amdgpu_irq_init(struct amdgpu_device *adev)
 	adev->irq.msi_enabled = false;
 
 	if (amdgpu_msi_ok(adev)) {
-#ifdef __linux__
 		int nvec = pci_msix_vec_count(adev->pdev);
 		unsigned int flags;
 
@@ -317,10 +332,6 @@ int amdgpu_irq_init(struct amdgpu_device *adev)
 		/* we only need one vector */
 		nvec = pci_alloc_irq_vectors(adev->pdev, 1, 1, flags);
 		if (nvec > 0) {
-#elif defined(__FreeBSD__)
-		int ret = pci_enable_msi(adev->pdev);
-		if (!ret) {
-#endif
 			adev->irq.msi_enabled = true;
 			dev_dbg(adev->dev, "using MSI/MSI-X.\n");
 		}
@@ -344,15 +355,21 @@ int amdgpu_irq_init(struct amdgpu_device *adev)
 	INIT_WORK(&adev->irq.ih1_work, amdgpu_irq_handle_ih1);
 	INIT_WORK(&adev->irq.ih2_work, amdgpu_irq_handle_ih2);
 	INIT_WORK(&adev->irq.ih_soft_work, amdgpu_irq_handle_ih_soft);
+#ifdef __FreeBSD__
+	adev->irq.ih1_wq = alloc_ordered_workqueue("amdgpu-ih1", WQ_HIGHPRI);
+	adev->irq.ih2_wq = alloc_ordered_workqueue("amdgpu-ih2", WQ_HIGHPRI);
+	adev->irq.ih_soft_wq = alloc_ordered_workqueue("amdgpu-ih-soft",
+						       WQ_HIGHPRI);
+	if (!adev->irq.ih1_wq || !adev->irq.ih2_wq || !adev->irq.ih_soft_wq) {
+		r = -ENOMEM;
+		goto err_wq;
+	}
+#endif
 
-#ifdef __linux__
 	/* Use vector 0 for MSI-X. */
 	r = pci_irq_vector(adev->pdev, 0);
-#elif defined(__FreeBSD__)
-	r = adev->pdev->irq;
-#endif
 	if (r < 0)
-		return r;
+		goto err_wq;
 	irq = r;
 
 	/* PCI devices require shared interrupts. */
@@ -361,7 +378,7 @@ int amdgpu_irq_init(struct amdgpu_device *adev)
 	if (r) {
 		if (!amdgpu_device_has_dc_support(adev))
 			flush_work(&adev->hotplug_work);
-		return r;
+		goto err_wq;
 	}
 	adev->irq.installed = true;
 	adev->irq.irq = irq;
@@ -369,6 +386,12 @@ int amdgpu_irq_init(struct amdgpu_device *adev)
 
 	DRM_DEBUG("amdgpu: irq initialized.\n");
 	return 0;
+
+err_wq:
+#ifdef __FreeBSD__
+	amdgpu_irq_destroy_wqs(adev);
+#endif
+	return r;
 }
 
 
@@ -383,6 +406,9 @@ void amdgpu_irq_fini_hw(struct amdgpu_device *adev)
 		if (!amdgpu_device_has_dc_support(adev))
 			flush_work(&adev->hotplug_work);
 	}
+#ifdef __FreeBSD__
+	amdgpu_irq_destroy_wqs(adev);
+#endif
 
 	amdgpu_ih_ring_fini(adev, &adev->irq.ih_soft);
 	amdgpu_ih_ring_fini(adev, &adev->irq.ih);
@@ -551,7 +577,7 @@ void amdgpu_irq_delegate(struct amdgpu_device *adev,
 			 unsigned int num_dw)
 {
 	amdgpu_ih_ring_write(&adev->irq.ih_soft, entry->iv_entry, num_dw);
-	schedule_work(&adev->irq.ih_soft_work);
+	amdgpu_irq_schedule_ih(adev, ih_soft);
 }
 
 /**
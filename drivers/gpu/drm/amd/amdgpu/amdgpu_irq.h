@@ -92,6 +92,9 @@ struct amdgpu_irq {
 	struct amdgpu_ih_ring		ih, ih1, ih2, ih_soft;
 	const struct amdgpu_ih_funcs    *ih_funcs;
 	struct work_struct		ih1_work, ih2_work, ih_soft_work;
+#ifdef __FreeBSD__
+	struct workqueue_struct		*ih1_wq, *ih2_wq, *ih_soft_wq;
+#endif
 	struct amdgpu_irq_src		self_irq;
 
 	/* gen irq stuff */
@@ -100,6 +103,18 @@ struct amdgpu_irq {
 	uint32_t                        srbm_soft_reset;
 };
 
+#ifdef __linux__
+#define amdgpu_irq_schedule_ih(adev, ring) \
+	schedule_work(&(adev)->irq.ring##_work)
+#elif defined(__FreeBSD__)
+/*
+ * The secondary IH rings are processed by threads of their own, so that a
+ * retry fault storm on IH1 doesn't hold up the system workqueue.
+ */
+#define amdgpu_irq_schedule_ih(adev, ring) \
+	queue_work((adev)->irq.ring##_wq, &(adev)->irq.ring##_work)
+#endif
+
 void amdgpu_irq_disable_all(struct amdgpu_device *adev);
 
 int amdgpu_irq_init(struct amdgpu_device *adev);
@@ -3,9 +3,16 @@
 
 #include <sys/param.h>
 #include <sys/ktr.h>
+#include <sys/sdt.h>
 
 #include "amdgpu.h"
 
+/* drm:amdgpu:: probes, defined in amdgpu_trace_points.c. */
+SDT_PROVIDER_DECLARE(drm);
+SDT_PROBE_DECLARE(drm, amdgpu, , sched_run_job);
+SDT_PROBE_DECLARE(drm, amdgpu, , bo_create);
+SDT_PROBE_DECLARE(drm, amdgpu, , bo_move);
+
 static inline void
 trace_amdgpu_iv(u_long ih __unused, struct amdgpu_iv_entry *iv){
 	CTR1(KTR_DRM, "amdgpu_iv %p", iv);
@@ -25,18 +32,26 @@ trace_amdgpu_cs(struct amdgpu_cs_parser *parser, struct amdgpu_job *job,
 static inline void
 trace_amdgpu_sched_run_job(struct amdgpu_job *job){
 	CTR1(KTR_DRM, "amdgpu_sched_run_job %p", job);
+	SDT_PROBE6(drm, amdgpu, , sched_run_job, job, job->base.id,
+	    to_amdgpu_ring(job->base.sched)->name,
+	    job->base.s_fence->finished.context,
+	    job->base.s_fence->finished.seqno, job->num_ibs);
 }
 
 static inline void
-trace_amdgpu_bo_create(void *bo)
+trace_amdgpu_bo_create(struct amdgpu_bo *bo)
 {
 	CTR1(KTR_DRM, "amdgpu_bo_create %p", bo);
+	SDT_PROBE6(drm, amdgpu, , bo_create, bo, amdgpu_bo_size(bo),
+	    bo->tbo.resource->mem_type, bo->preferred_domains,
+	    bo->allowed_domains, bo->flags);
 }
 
 static inline void
 trace_amdgpu_bo_move(struct amdgpu_bo* bo, uint32_t new, uint32_t old)
 {
 	CTR3(KTR_DRM, "amdgpu_bo_move %p %u %u", bo, new, old);
+	SDT_PROBE4(drm, amdgpu, , bo_move, bo, amdgpu_bo_size(bo), old, new);
 }
 
 static inline void
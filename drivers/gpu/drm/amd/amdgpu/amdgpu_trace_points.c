@@ -28,3 +28,12 @@
 
 #define CREATE_TRACE_POINTS
 #include "amdgpu_trace.h"
+
+#ifdef __FreeBSD__
+SDT_PROBE_DEFINE6(drm, amdgpu, , sched_run_job, "struct amdgpu_job *",
+    "uint64_t", "char *", "uint64_t", "uint64_t", "uint32_t");
+SDT_PROBE_DEFINE6(drm, amdgpu, , bo_create, "struct amdgpu_bo *",
+    "unsigned long", "uint32_t", "uint32_t", "uint32_t", "uint64_t");
+SDT_PROBE_DEFINE4(drm, amdgpu, , bo_move, "struct amdgpu_bo *",
+    "unsigned long", "uint32_t", "uint32_t");
+#endif
@@ -489,7 +489,7 @@ static int ih_v6_0_self_irq(struct amdgpu_device *adev,
 	switch (entry->ring_id) {
 	case 1:
 		*adev->irq.ih1.wptr_cpu = wptr;
-		schedule_work(&adev->irq.ih1_work);
+		amdgpu_irq_schedule_ih(adev, ih1);
 		break;
 	default: break;
 	}
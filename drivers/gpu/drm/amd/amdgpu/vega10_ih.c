@@ -446,10 +446,10 @@ static int vega10_ih_self_irq(struct amdgpu_device *adev,
 {
 	switch (entry->ring_id) {
 	case 1:
-		schedule_work(&adev->irq.ih1_work);
+		amdgpu_irq_schedule_ih(adev, ih1);
 		break;
 	case 2:
-		schedule_work(&adev->irq.ih2_work);
+		amdgpu_irq_schedule_ih(adev, ih2);
 		break;
 	default: break;
 	}
@@ -498,10 +498,10 @@ static int vega20_ih_self_irq(struct amdgpu_device *adev,
 {
 	switch (entry->ring_id) {
 	case 1:
-		schedule_work(&adev->irq.ih1_work);
+		amdgpu_irq_schedule_ih(adev, ih1);
 		break;
 	case 2:
-		schedule_work(&adev->irq.ih2_work);
+		amdgpu_irq_schedule_ih(adev, ih2);
 		break;
 	default: break;
 	}
@@ -37,6 +37,11 @@
 
 #include <drm/drm_cache.h>
 
+#ifdef __FreeBSD__
+#include <vm/vm.h>
+#include <vm/vm_phys.h>
+#endif
+
 /* A small bounce buffer that fits on the stack. */
 #define MEMCPY_BOUNCE_SIZE 128
 
@@ -215,9 +220,12 @@ bool drm_need_swiotlb(int dma_bits)
 
 	return max_iomem > ((u64)1 << dma_bits);
 #elif defined(__FreeBSD__)
-	// Only used in combination with CONFIG_SWIOTLB in v4.17
-	// BSDFIXME: Let's say we can dma all physical memory...
-	return false;
+	/*
+	 * Without swiotlb, this selects the coherent DMA page pool of TTM
+	 * whenever RAM extends beyond what the device can address, instead
+	 * of leaving it to busdma bounce buffering.
+	 */
+	return vm_phys_segs[vm_phys_nsegs - 1].end > ((u64)1 << dma_bits);
 #endif
 }
 EXPORT_SYMBOL(drm_need_swiotlb);
@@ -38,6 +38,10 @@
 #include <drm/drm_edid.h>
 #include <drm/drm_file.h>
 #include <drm/drm_gem.h>
+#include <drm/drm_print.h>
+#ifdef __FreeBSD__
+#include <drm/gpu_scheduler.h>
+#endif
 
 #include "drm_crtc_internal.h"
 #include "drm_internal.h"
@@ -148,10 +152,26 @@ static int drm_gem_name_info(struct seq_file *m, void *data)
 	return 0;
 }
 
+#ifdef __FreeBSD__
+static int drm_sched_latency_info(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = (struct drm_info_node *) m->private;
+	struct drm_device *dev = node->minor->dev;
+	struct drm_printer p = drm_seq_file_printer(m);
+
+	drm_sched_lat_print(&p, dev->dev);
+
+	return 0;
+}
+#endif
+
 static const struct drm_info_list drm_debugfs_list[] = {
 	{"name", drm_name_info, 0},
 	{"clients", drm_clients_info, 0},
 	{"gem_names", drm_gem_name_info, DRIVER_GEM},
+#ifdef __FreeBSD__
+	{"sched_latency", drm_sched_latency_info, 0},
+#endif
 };
 #define DRM_DEBUGFS_ENTRIES ARRAY_SIZE(drm_debugfs_list)
 
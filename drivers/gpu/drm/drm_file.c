@@ -559,6 +559,10 @@ EXPORT_SYMBOL(drm_release_noglobal);
  * the maximum event space is currently 4K it's recommended to just use that for
  * safety.
  *
+ * All queued events that fit into the buffer are returned by a single call,
+ * so a 4K buffer drains everything pending at once. On FreeBSD the number of
+ * bytes pending can be queried with the FIONREAD ioctl.
+ *
  * RETURNS:
  *
  * Number of bytes read (always aligned to full events, and can be 0) or a
@@ -576,18 +580,36 @@ ssize_t drm_read(struct file *filp, char __user *buffer,
 		return ret;
 
 	for (;;) {
-		struct drm_pending_event *e = NULL;
-
+		struct drm_pending_event *e, *et;
+		LIST_HEAD(batch);
+		size_t batch_len = 0;
+
+		/*
+		 * Take every queued event that fits into the rest of the
+		 * buffer under one hold of the event lock, so that a single
+		 * read() drains all the vblank and flip events of a frame.
+		 */
 		spin_lock_irq(&dev->event_lock);
-		if (!list_empty(&file_priv->event_list)) {
-			e = list_first_entry(&file_priv->event_list,
-					struct drm_pending_event, link);
-			file_priv->event_space += e->event->length;
-			list_del(&e->link);
+		list_for_each_entry_safe(e, et, &file_priv->event_list, link) {
+			unsigned length = e->event->length;
+
+			if (length > count - ret - batch_len)
+				break;
+			batch_len += length;
+			file_priv->event_space += length;
+#ifdef __FreeBSD__
+			file_priv->event_pending -= length;
+#endif
+			list_move_tail(&e->link, &batch);
+		}
+		if (list_empty(&batch) && !list_empty(&file_priv->event_list)) {
+			/* The next event does not fit, leave it queued. */
+			spin_unlock_irq(&dev->event_lock);
+			break;
 		}
 		spin_unlock_irq(&dev->event_lock);
 
-		if (e == NULL) {
+		if (list_empty(&batch)) {
 			if (ret)
 				break;
 
@@ -603,33 +625,40 @@ ssize_t drm_read(struct file *filp, char __user *buffer,
 				ret = mutex_lock_interruptible(&file_priv->event_read_lock);
 			if (ret)
 				return ret;
-		} else {
+			continue;
+		}
+
+		list_for_each_entry_safe(e, et, &batch, link) {
 			unsigned length = e->event->length;
 
-			if (length > count - ret) {
-put_back_event:
-				spin_lock_irq(&dev->event_lock);
-				file_priv->event_space -= length;
-				list_add(&e->link, &file_priv->event_list);
-				spin_unlock_irq(&dev->event_lock);
-#ifdef __linux__
-				wake_up_interruptible_poll(&file_priv->event_wait,
-					EPOLLIN | EPOLLRDNORM);
-#elif defined(__FreeBSD__)
-				wake_up_interruptible(&file_priv->event_wait);
-#endif
+			if (copy_to_user(buffer + ret, e->event, length))
 				break;
-			}
-
-			if (copy_to_user(buffer + ret, e->event, length)) {
-				if (ret == 0)
-					ret = -EFAULT;
-				goto put_back_event;
-			}
 
 			ret += length;
+			batch_len -= length;
+			list_del(&e->link);
 			kfree(e);
 		}
+
+		if (!list_empty(&batch)) {
+			/* Put the events we failed to copy back in order. */
+			spin_lock_irq(&dev->event_lock);
+			file_priv->event_space -= batch_len;
+#ifdef __FreeBSD__
+			file_priv->event_pending += batch_len;
+#endif
+			list_splice(&batch, &file_priv->event_list);
+			spin_unlock_irq(&dev->event_lock);
+#ifdef __linux__
+			wake_up_interruptible_poll(&file_priv->event_wait,
+				EPOLLIN | EPOLLRDNORM);
+#elif defined(__FreeBSD__)
+			wake_up_interruptible(&file_priv->event_wait);
+#endif
+			if (ret == 0)
+				ret = -EFAULT;
+			break;
+		}
 	}
 	mutex_unlock(&file_priv->event_read_lock);
 
@@ -804,6 +833,9 @@ static void drm_send_event_helper(struct drm_device *dev,
 	list_del(&e->pending_link);
 	list_add_tail(&e->link,
 		      &e->file_priv->event_list);
+#ifdef __FreeBSD__
+	e->file_priv->event_pending += e->event->length;
+#endif
 #ifdef __linux__
 	wake_up_interruptible_poll(&e->file_priv->event_wait,
 		EPOLLIN | EPOLLRDNORM);
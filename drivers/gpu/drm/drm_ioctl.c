@@ -33,6 +33,10 @@
 #include <linux/pci.h>
 #include <linux/uaccess.h>
 
+#ifdef __FreeBSD__
+#include <sys/filio.h>
+#endif
+
 #include <drm/drm_auth.h>
 #include <drm/drm_crtc.h>
 #include <drm/drm_drv.h>
@@ -842,6 +846,15 @@ long drm_ioctl(struct file *filp,
 		return -ENODEV;
 
 #ifdef __FreeBSD__
+	if (cmd == FIONREAD) {
+		int pending;
+
+		spin_lock_irq(&dev->event_lock);
+		pending = file_priv->event_pending;
+		spin_unlock_irq(&dev->event_lock);
+		return put_user(pending, (int __user *)arg);
+	}
+
 	if (IOCGROUP(cmd) != DRM_IOCTL_BASE) {
 		DRM_DEBUG("bad ioctl group 0x%x\n", (int)IOCGROUP(cmd));
 		return -EINVAL;
@@ -153,11 +153,144 @@ INTERVAL_TREE_DEFINE(struct drm_mm_node, rb,
 		     u64, __subtree_last,
 		     START, LAST, static inline, drm_mm_interval_tree)
 
+#ifdef __FreeBSD__
+/*
+ * The LinuxKPI rbtree is a thin wrapper around sys/tree.h and provides no
+ * augmented callbacks: rb_insert_color() and rb_erase() rotate nodes without
+ * telling us, which leaves __subtree_last and subtree_max_hole stale and
+ * defeats the pruning done by the hole and interval searches.
+ *
+ * Rebalancing only ever rotates nodes that end up on, or directly below, the
+ * path from the modified position to the root.  Recomputing each node on that
+ * path together with its immediate children after the tree operation
+ * restores the augmented invariant in O(log n).
+ */
+#define DRM_MM_RB_DECLARE_CALLBACKS_MAX(RBNAME, RBSTRUCT, RBFIELD,	\
+					RBTYPE, RBAUGMENTED, RBCOMPUTE)	\
+static inline void							\
+RBNAME ## _compute_max(struct rb_node *rb)				\
+{									\
+	RBSTRUCT *node, *child;						\
+	RBTYPE max;							\
+									\
+	if (!rb)							\
+		return;							\
+									\
+	node = rb_entry(rb, RBSTRUCT, RBFIELD);				\
+	max = RBCOMPUTE(node);						\
+	if (rb->rb_left) {						\
+		child = rb_entry(rb->rb_left, RBSTRUCT, RBFIELD);	\
+		if (child->RBAUGMENTED > max)				\
+			max = child->RBAUGMENTED;			\
+	}								\
+	if (rb->rb_right) {						\
+		child = rb_entry(rb->rb_right, RBSTRUCT, RBFIELD);	\
+		if (child->RBAUGMENTED > max)				\
+			max = child->RBAUGMENTED;			\
+	}								\
+	node->RBAUGMENTED = max;					\
+}									\
+									\
+static inline void							\
+RBNAME ## _fixup(struct rb_node *rb)					\
+{									\
+	for (; rb; rb = rb_parent(rb)) {				\
+		RBNAME ## _compute_max(rb->rb_left);			\
+		RBNAME ## _compute_max(rb->rb_right);			\
+		RBNAME ## _compute_max(rb);				\
+	}								\
+}									\
+									\
+/* Lowest node whose subtree changes when @rb is unlinked. */		\
+static inline struct rb_node *						\
+RBNAME ## _erase_begin(struct rb_node *rb)				\
+{									\
+	struct rb_node *succ;						\
+									\
+	if (!rb->rb_left || !rb->rb_right)				\
+		return rb_parent(rb);					\
+									\
+	succ = rb->rb_right;						\
+	while (succ->rb_left)						\
+		succ = succ->rb_left;					\
+									\
+	return rb_parent(succ) == rb ? succ : rb_parent(succ);		\
+}
+
+DRM_MM_RB_DECLARE_CALLBACKS_MAX(drm_mm_interval_tree_augment,
+				struct drm_mm_node, rb,
+				u64, __subtree_last, LAST)
+
+static void drm_mm_interval_tree_erase(struct drm_mm_node *node,
+				       struct rb_root_cached *root)
+{
+	struct rb_node *rb = drm_mm_interval_tree_augment_erase_begin(&node->rb);
+
+	rb_erase_cached(&node->rb, root);
+	drm_mm_interval_tree_augment_fixup(rb);
+}
+
+static struct drm_mm_node *
+drm_mm_interval_tree_subtree_search(struct drm_mm_node *node,
+				    u64 start, u64 last)
+{
+	struct drm_mm_node *child;
+
+	for (;;) {
+		/* Any overlap in the left subtree comes first. */
+		if (node->rb.rb_left) {
+			child = rb_entry(node->rb.rb_left, struct drm_mm_node, rb);
+			if (start <= child->__subtree_last) {
+				node = child;
+				continue;
+			}
+		}
+		if (START(node) > last)
+			return NULL;
+		if (start <= LAST(node))
+			return node;
+		if (!node->rb.rb_right)
+			return NULL;
+		node = rb_entry(node->rb.rb_right, struct drm_mm_node, rb);
+		if (start > node->__subtree_last)
+			return NULL;
+	}
+}
+
+static struct drm_mm_node *
+drm_mm_interval_tree_lookup(struct rb_root_cached *root, u64 start, u64 last)
+{
+	struct drm_mm_node *node, *leftmost;
+
+	if (!root->rb_root.rb_node)
+		return NULL;
+
+	node = rb_entry(root->rb_root.rb_node, struct drm_mm_node, rb);
+	if (node->__subtree_last < start)
+		return NULL;
+
+	leftmost = rb_entry(root->rb_leftmost, struct drm_mm_node, rb);
+	if (START(leftmost) > last)
+		return NULL;
+
+	return drm_mm_interval_tree_subtree_search(node, start, last);
+}
+#endif
+
 struct drm_mm_node *
 __drm_mm_interval_first(const struct drm_mm *mm, u64 start, u64 last)
 {
+#ifdef __linux__
 	return drm_mm_interval_tree_iter_first((struct rb_root_cached *)&mm->interval_tree,
 					       start, last) ?: (struct drm_mm_node *)&mm->head_node;
+#elif defined(__FreeBSD__)
+	/*
+	 * The LinuxKPI interval tree iterates linearly from the leftmost
+	 * node; use the augmented data maintained above to prune instead.
+	 */
+	return drm_mm_interval_tree_lookup((struct rb_root_cached *)&mm->interval_tree,
+					   start, last) ?: (struct drm_mm_node *)&mm->head_node;
+#endif
 }
 EXPORT_SYMBOL(__drm_mm_interval_first);
 
@@ -210,6 +343,7 @@ static void drm_mm_interval_tree_add_node(struct drm_mm_node *hole_node,
 				   &drm_mm_interval_tree_augment);
 #elif defined(__FreeBSD__)
 	rb_insert_color_cached(&node->rb, &mm->interval_tree, leftmost);
+	drm_mm_interval_tree_augment_fixup(&node->rb);
 #endif
 }
 
@@ -246,6 +380,10 @@ static void insert_hole_size(struct rb_root_cached *root,
 RB_DECLARE_CALLBACKS_MAX(static, augment_callbacks,
 			 struct drm_mm_node, rb_hole_addr,
 			 u64, subtree_max_hole, HOLE_SIZE)
+#elif defined(__FreeBSD__)
+DRM_MM_RB_DECLARE_CALLBACKS_MAX(augment_callbacks,
+				struct drm_mm_node, rb_hole_addr,
+				u64, subtree_max_hole, HOLE_SIZE)
 #endif
 
 static void insert_hole_addr(struct rb_root *root, struct drm_mm_node *node)
@@ -270,6 +408,7 @@ static void insert_hole_addr(struct rb_root *root, struct drm_mm_node *node)
 	rb_insert_augmented(&node->rb_hole_addr, root, &augment_callbacks);
 #elif defined(__FreeBSD__)
 	rb_insert_color(&node->rb_hole_addr, root);
+	augment_callbacks_fixup(&node->rb_hole_addr);
 #endif
 }
 
@@ -290,6 +429,10 @@ static void add_hole(struct drm_mm_node *node)
 
 static void rm_hole(struct drm_mm_node *node)
 {
+#ifdef __FreeBSD__
+	struct rb_node *rb;
+#endif
+
 	DRM_MM_BUG_ON(!drm_mm_hole_follows(node));
 
 	list_del(&node->hole_stack);
@@ -298,7 +441,9 @@ static void rm_hole(struct drm_mm_node *node)
 	rb_erase_augmented(&node->rb_hole_addr, &node->mm->holes_addr,
 			   &augment_callbacks);
 #elif defined(__FreeBSD__)
+	rb = augment_callbacks_erase_begin(&node->rb_hole_addr);
 	rb_erase(&node->rb_hole_addr, &node->mm->holes_addr);
+	augment_callbacks_fixup(rb);
 #endif
 	node->hole_size = 0;
 	node->subtree_max_hole = 0;
@@ -651,7 +796,11 @@ void drm_mm_remove_node(struct drm_mm_node *node)
 	if (drm_mm_hole_follows(node))
 		rm_hole(node);
 
+#ifdef __linux__
 	drm_mm_interval_tree_remove(node, &mm->interval_tree);
+#elif defined(__FreeBSD__)
+	drm_mm_interval_tree_erase(node, &mm->interval_tree);
+#endif
 	list_del(&node->node_list);
 
 	if (drm_mm_hole_follows(prev_node))
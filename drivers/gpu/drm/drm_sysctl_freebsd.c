@@ -32,10 +32,12 @@ __FBSDID("$FreeBSD$");
 #include <drm/drm_drv.h>
 #include <drm/drm_print.h>
 #include <drm/drm_vblank.h>
+#include <drm/gpu_scheduler.h>
 #include <uapi/drm/drm.h>
 #include "drm_internal.h"
 #include "drm_legacy.h"
 
+#include <sys/sbuf.h>
 #include <sys/sysctl.h>
 
 
@@ -52,6 +54,7 @@ extern unsigned int drm_timestamp_precision;
 static int	   drm_name_info DRM_SYSCTL_HANDLER_ARGS;
 static int	   drm_clients_info DRM_SYSCTL_HANDLER_ARGS;
 static int	   drm_vblank_info DRM_SYSCTL_HANDLER_ARGS;
+static int	   drm_sched_latency_info DRM_SYSCTL_HANDLER_ARGS;
 
 struct drm_sysctl_list {
 	const char *name;
@@ -60,6 +63,7 @@ struct drm_sysctl_list {
 	{"name",    drm_name_info},
 	{"clients", drm_clients_info},
 	{"vblank",    drm_vblank_info},
+	{"sched_latency", drm_sched_latency_info},
 };
 #define DRM_SYSCTL_ENTRIES (sizeof(drm_sysctl_list)/sizeof(drm_sysctl_list[0]))
 
@@ -304,3 +308,29 @@ done:
 	SYSCTL_OUT(req, "", -1);
 	return retcode;
 }
+
+static void
+drm_sysctl_printfn(struct drm_printer *p, struct va_format *vaf)
+{
+	sbuf_vprintf(p->arg, vaf->fmt, *vaf->va);
+}
+
+static int drm_sched_latency_info DRM_SYSCTL_HANDLER_ARGS
+{
+	struct drm_device *dev = arg1;
+	struct drm_printer p;
+	struct sbuf sb;
+	int retcode;
+
+	sbuf_new_for_sysctl(&sb, NULL, 512, req);
+	p = (struct drm_printer){
+		.printfn = drm_sysctl_printfn,
+		.arg = &sb,
+	};
+	drm_printf(&p, "\n");
+	drm_sched_lat_print(&p, dev->dev);
+	retcode = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+
+	return retcode;
+}
@@ -31,11 +31,18 @@
 
 #include <sys/param.h>
 #include <sys/ktr.h>
+#include <sys/sdt.h>
 
 #include <linux/ktime.h>
 
 struct drm_file;
 
+/* drm:vblank:: probes, defined in drm_vblank.c. */
+SDT_PROVIDER_DECLARE(drm);
+SDT_PROBE_DECLARE(drm, vblank, , event);
+SDT_PROBE_DECLARE(drm, vblank, , event_queued);
+SDT_PROBE_DECLARE(drm, vblank, , event_delivered);
+
 /* TRACE_EVENT(drm_vblank_event, */
 /* TP_PROTO(int crtc, unsigned int seq, ktime_t time, bool high_prec), */
 static inline void
@@ -43,6 +50,7 @@ trace_drm_vblank_event(int crtc, unsigned int seq, ktime_t time, bool high_prec)
 {
 	CTR4(KTR_DRM, "drm_vblank_event crtc %d, seq %u, time %lld, "
 	    "high-prec %s", crtc, seq, time, high_prec ? "true" : "false");
+	SDT_PROBE4(drm, vblank, , event, crtc, seq, time, high_prec);
 }
 
 /* TRACE_EVENT(drm_vblank_event_queued, */
@@ -52,6 +60,7 @@ trace_drm_vblank_event_queued(struct drm_file *file, int crtc, unsigned int seq)
 {
 	CTR3(KTR_DRM, "drm_vblank_event_queued drm_file %p, crtc %d, seq %u",
 	    file, crtc, seq);
+	SDT_PROBE3(drm, vblank, , event_queued, file, crtc, seq);
 }
 
 /* TRACE_EVENT(drm_vblank_event_delivered, */
@@ -60,6 +69,7 @@ static inline void
 trace_drm_vblank_event_delivered(struct drm_file *file, int crtc, unsigned int seq)
 {
 	CTR3(KTR_DRM, "drm_vblank_event_delivered drm_file %p, crtc %d, seq %u", file, crtc, seq);
+	SDT_PROBE3(drm, vblank, , event_delivered, file, crtc, seq);
 }
 
 #endif
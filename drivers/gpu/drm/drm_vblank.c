@@ -41,6 +41,13 @@
 #include "drm_trace.h"
 #else
 #include "drm_trace_freebsd.h"
+
+SDT_PROBE_DEFINE4(drm, vblank, , event, "int", "unsigned int", "int64_t",
+    "bool");
+SDT_PROBE_DEFINE3(drm, vblank, , event_queued, "struct drm_file *", "int",
+    "unsigned int");
+SDT_PROBE_DEFINE3(drm, vblank, , event_delivered, "struct drm_file *", "int",
+    "unsigned int");
 #endif
 
 /**
@@ -10,6 +10,13 @@
 
 #include <drm/drm_cache.h>
 
+#ifdef __FreeBSD__
+#include <vm/vm.h>
+#include <vm/pmap.h>
+#include <vm/vm_object.h>
+#include <vm/vm_page.h>
+#endif
+
 #include "gem/i915_gem_region.h"
 #include "i915_drv.h"
 #include "i915_gem_object.h"
@@ -233,6 +240,11 @@ static int shmem_get_pages(struct drm_i915_gem_object *obj)
 	GEM_BUG_ON(obj->read_domains & I915_GEM_GPU_DOMAINS);
 	GEM_BUG_ON(obj->write_domain & I915_GEM_GPU_DOMAINS);
 
+#ifdef __FreeBSD__
+	if (i915->mm.gemfs)
+		i915_gemfs_populate(mapping, obj->base.size);
+#endif
+
 rebuild_st:
 	st = kmalloc(sizeof(*st), GFP_KERNEL | __GFP_NOWARN);
 	if (!st)
@@ -317,8 +329,47 @@ shmem_truncate(struct drm_i915_gem_object *obj)
 }
 
 #ifdef __FreeBSD__
+#ifndef SWAP_CLUSTER_MAX
+#define	SWAP_CLUSTER_MAX	32UL
+#endif
+
 void __shmem_writeback(size_t size, vm_object_t mapping)
 {
+	const vm_pindex_t end = size >> PAGE_SHIFT;
+	vm_pindex_t pindex = 0;
+	unsigned long batch;
+	vm_page_t m;
+
+	/*
+	 * As on Linux, leave CPU mmapings intact. Instead of starting
+	 * the pageout ourselves, which the swap pager would do
+	 * synchronously outside of the pagedaemon, move the dirty unmapped
+	 * pages to the laundry queue so that the laundry thread writes them
+	 * to swap in the background and they can be freed once clean.
+	 *
+	 * Work in SWAP_CLUSTER_MAX sized batches, dropping the object lock
+	 * in between so that large objects do not stall faults.
+	 */
+	VM_OBJECT_WLOCK(mapping);
+	m = vm_page_find_least(mapping, 0);
+	while (m != NULL && m->pindex < end) {
+		for (batch = 0; m != NULL && m->pindex < end &&
+		    batch < SWAP_CLUSTER_MAX; batch++) {
+			if (!vm_page_wired(m) && !pmap_page_is_mapped(m) &&
+			    m->dirty != 0)
+				vm_page_launder(m);
+			pindex = m->pindex + 1;
+			m = TAILQ_NEXT(m, listq);
+		}
+		if (m == NULL || m->pindex >= end)
+			break;
+
+		VM_OBJECT_WUNLOCK(mapping);
+		cond_resched();
+		VM_OBJECT_WLOCK(mapping);
+		m = vm_page_find_least(mapping, pindex);
+	}
+	VM_OBJECT_WUNLOCK(mapping);
 }
 #else
 void __shmem_writeback(size_t size, struct address_space *mapping)
@@ -598,14 +649,12 @@ static int __create_shmem(struct drm_i915_private *i915,
 
 	drm_gem_private_object_init(&i915->drm, obj, size);
 
-	if (i915->mm.gemfs)
 #ifdef __linux__
+	if (i915->mm.gemfs)
 		filp = shmem_file_setup_with_mnt(i915->mm.gemfs, "i915", size,
 						 flags);
-#elif defined(__FreeBSD__)
-		panic("i915_gem.c: gemfs not supported\n");
-#endif
 	else
+#endif
 		filp = shmem_file_setup("i915", size, flags);
 	if (IS_ERR(filp))
 		return PTR_ERR(filp);
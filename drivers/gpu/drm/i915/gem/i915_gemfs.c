@@ -7,10 +7,19 @@
 #include <linux/fs.h>
 #include <linux/mount.h>
 
+#ifdef __FreeBSD__
+#include <vm/vm.h>
+#include <vm/vm_object.h>
+#include <vm/vm_page.h>
+#include <vm/vm_pager.h>
+#include <vm/swap_pager.h>
+#endif
+
 #include "i915_drv.h"
 #include "i915_gemfs.h"
 #include "i915_utils.h"
 
+#ifdef __linux__
 void i915_gemfs_init(struct drm_i915_private *i915)
 {
 	char huge_opt[] = "huge=within_size"; /* r/w */
@@ -58,3 +67,97 @@ void i915_gemfs_fini(struct drm_i915_private *i915)
 {
 	kern_unmount(i915->mm.gemfs);
 }
+#elif defined(__FreeBSD__)
+/*
+ * There is no tmpfs to mount with huge=within_size here, so "gemfs" is a
+ * policy applied to the plain shmem VM object: before the pages are looked
+ * up one at a time, every naturally aligned 2M (and then 64K) range of the
+ * object that has neither resident nor swapped out pages is filled with a
+ * physically contiguous, equally aligned run. The scatterlist then coalesces
+ * those runs and the GTT can use 2M and 64K entries for them.
+ */
+static const unsigned int i915_gemfs_orders[] = {
+	21 - PAGE_SHIFT,	/* 2M */
+	16 - PAGE_SHIFT,	/* 64K */
+};
+
+void i915_gemfs_init(struct drm_i915_private *i915)
+{
+	/* Same policy as the Linux gemfs; see above. */
+	if (GRAPHICS_VER(i915) < 11 && !i915_vtd_active(i915))
+		return;
+
+	i915->mm.gemfs = true;
+	drm_info(&i915->drm, "Using contiguous 2M/64K backing for shmem objects\n");
+}
+
+void i915_gemfs_fini(struct drm_i915_private *i915)
+{
+	i915->mm.gemfs = false;
+}
+
+static bool
+i915_gemfs_range_empty(vm_object_t obj, vm_pindex_t pindex, vm_pindex_t count)
+{
+	vm_page_t m;
+
+	m = vm_page_find_least(obj, pindex);
+	if (m != NULL && m->pindex < pindex + count)
+		return false;
+
+	return swap_pager_find_least(obj, pindex) >= pindex + count;
+}
+
+static bool
+i915_gemfs_alloc_run(vm_object_t obj, vm_pindex_t pindex, unsigned int order)
+{
+	const u_long npages = 1UL << order;
+	vm_page_t m;
+	u_long i;
+
+	m = vm_page_alloc_contig(obj, pindex, VM_ALLOC_NORMAL | VM_ALLOC_ZERO,
+	    npages, 0, ~(vm_paddr_t)0, npages << PAGE_SHIFT, 0, obj->memattr);
+	if (m == NULL)
+		return false;
+
+	for (i = 0; i < npages; i++) {
+		if ((m[i].flags & PG_ZERO) == 0)
+			pmap_zero_page(&m[i]);
+		vm_page_valid(&m[i]);
+		vm_page_activate(&m[i]);
+		vm_page_xunbusy(&m[i]);
+	}
+
+	return true;
+}
+
+/**
+ * i915_gemfs_populate - back a shmem object with contiguous page runs
+ * @mapping: the VM object behind the shmem file
+ * @size: size of the object in bytes
+ *
+ * Best effort only: a range that cannot be allocated contiguously without
+ * reclaim is left alone and faulted in page by page by the caller.
+ */
+void i915_gemfs_populate(vm_object_t mapping, size_t size)
+{
+	const vm_pindex_t page_count = size >> PAGE_SHIFT;
+	vm_pindex_t pindex, count;
+	unsigned int i;
+
+	VM_OBJECT_WLOCK(mapping);
+	for (i = 0; i < ARRAY_SIZE(i915_gemfs_orders); i++) {
+		count = 1UL << i915_gemfs_orders[i];
+
+		for (pindex = 0; pindex + count <= page_count; pindex += count) {
+			if (!i915_gemfs_range_empty(mapping, pindex, count))
+				continue;
+
+			if (!i915_gemfs_alloc_run(mapping, pindex,
+						  i915_gemfs_orders[i]))
+				break;
+		}
+	}
+	VM_OBJECT_WUNLOCK(mapping);
+}
+#endif
@@ -9,21 +9,10 @@
 
 struct drm_i915_private;
 
-#ifdef __linux__
 void i915_gemfs_init(struct drm_i915_private *i915);
 void i915_gemfs_fini(struct drm_i915_private *i915);
-#elif defined(__FreeBSD__)
-static inline void
-i915_gemfs_init(struct drm_i915_private *i915)
-{
-	return;
-}
-
-static inline void
-i915_gemfs_fini(struct drm_i915_private *i915)
-{
-	return;
-}
+#ifdef __FreeBSD__
+void i915_gemfs_populate(vm_object_t mapping, size_t size);
 #endif
 
 #endif
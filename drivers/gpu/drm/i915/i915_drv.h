@@ -149,10 +149,17 @@ struct i915_gem_mm {
 	 */
 	atomic_t free_count;
 
+#ifdef __linux__
 	/**
 	 * tmpfs instance used for shmem backed objects
 	 */
 	struct vfsmount *gemfs;
+#elif defined(__FreeBSD__)
+	/**
+	 * back shmem objects with contiguous runs, see i915_gemfs_populate()
+	 */
+	bool gemfs;
+#endif
 
 	struct intel_memory_region *regions[INTEL_REGION_UNKNOWN];
 
@@ -879,12 +879,7 @@ request_alloc_slow(struct intel_timeline *tl,
 
 	/* Ratelimit ourselves to prevent oom from malicious clients */
 	rq = list_last_entry(&tl->requests, typeof(*rq), link);
-#ifdef __linux__
 	cond_synchronize_rcu(rq->rcustate);
-#elif defined(__FreeBSD__)
-	/* BSDFIXME: OK to always synchronize here? */
-	synchronize_rcu();
-#endif
 
 	/* Retire our old requests in the hope that we free some */
 	retire_requests(tl);
@@ -983,11 +978,7 @@ __i915_request_create(struct intel_context *ce, gfp_t gfp)
 	rq->hwsp_seqno = tl->hwsp_seqno;
 	GEM_BUG_ON(__i915_request_is_complete(rq));
 
-#ifdef __linux__
 	rq->rcustate = get_state_synchronize_rcu(); /* acts as smp_mb() */
-#elif __FreeBSD__
-	smp_mb();
-#endif
 
 	rq->guc_prio = GUC_PRIO_INIT;
 
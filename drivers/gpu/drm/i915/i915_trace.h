@@ -3,12 +3,27 @@
 
 #include <sys/param.h>
 #include <sys/ktr.h>
+#include <sys/sdt.h>
 
 #include "i915_drv.h"
 #include "intel_crtc.h"
 #include "intel_display_types.h"
 #include "gt/intel_engine.h"
 
+/* drm:i915:: probes, defined in i915_trace_points.c. */
+SDT_PROVIDER_DECLARE(drm);
+SDT_PROBE_DECLARE(drm, i915, , request_submit);
+SDT_PROBE_DECLARE(drm, i915, , request_in);
+SDT_PROBE_DECLARE(drm, i915, , request_out);
+SDT_PROBE_DECLARE(drm, i915, , request_wait_begin);
+SDT_PROBE_DECLARE(drm, i915, , request_wait_end);
+SDT_PROBE_DECLARE(drm, i915, , gem_object_create);
+SDT_PROBE_DECLARE(drm, i915, , vma_bind);
+SDT_PROBE_DECLARE(drm, i915, , vma_unbind);
+SDT_PROBE_DECLARE(drm, i915, , gem_evict);
+SDT_PROBE_DECLARE(drm, i915, , gem_evict_node);
+SDT_PROBE_DECLARE(drm, i915, , gem_evict_vm);
+
 static inline void
 trace_i915_flip_complete(int plane, struct drm_i915_gem_object *pending_flip_obj)
 {
@@ -55,6 +70,7 @@ static inline void
 trace_i915_gem_object_create(struct drm_i915_gem_object *obj)
 {
 	CTR1(KTR_DRM, "object_create %p", obj);
+	SDT_PROBE2(drm, i915, , gem_object_create, obj, obj->base.size);
 }
 
 static inline void
@@ -129,13 +145,22 @@ trace_i915_gem_object_destroy(struct drm_i915_gem_object *obj)
 	CTR1(KTR_DRM, "object_destroy_tail %p", obj);
 }
 
-#define trace_i915_gem_evict(vm, min_size, alignment, flags) \
-CTR4(KTR_DRM, "evict_something %p %d %u %x", vm, min_size, alignment, flags)
+static inline void
+trace_i915_gem_evict(struct i915_address_space *vm, u64 min_size,
+    u64 alignment, unsigned int flags)
+{
+	CTR4(KTR_DRM, "evict_something %p %jx %jx %x", vm, (uintmax_t)min_size,
+	    (uintmax_t)alignment, flags);
+	SDT_PROBE5(drm, i915, , gem_evict, vm->i915->drm.primary->index, vm,
+	    min_size, alignment, flags);
+}
 
 static inline void
 trace_i915_gem_evict_vm(struct i915_address_space *vm)
 {
 	CTR1(KTR_DRM, "evict_vm %p", vm);
+	SDT_PROBE2(drm, i915, , gem_evict_vm, vm->i915->drm.primary->index,
+	    vm);
 }
 
 static inline void
@@ -148,6 +173,8 @@ trace_i915_gem_evict_node(struct i915_address_space *vm,
 						  struct drm_mm_node *target,
 						  unsigned int flags) {
 	CTR3(KTR_DRM, "evict_node vm %p, target %p, flags %u", vm, target, flags);
+	SDT_PROBE6(drm, i915, , gem_evict_node, vm->i915->drm.primary->index,
+	    vm, target->start, target->size, target->color, flags);
 }
 
 static inline void
@@ -288,13 +315,21 @@ trace_intel_context_do_unpin(struct intel_context *ctx)
 }
 
 static inline void
-trace_i915_request_wait_begin(void *req, uint32_t flags) {
+trace_i915_request_wait_begin(struct i915_request *req, uint32_t flags) {
 	CTR2(KTR_DRM, "request_wait_begin req %p flags %x", req, flags);
+	SDT_PROBE7(drm, i915, , request_wait_begin, req,
+	    req->engine->i915->drm.primary->index,
+	    req->engine->uabi_class, req->engine->uabi_instance,
+	    req->fence.context, req->fence.seqno, flags);
 }
 
 static inline void
-trace_i915_request_wait_end(void *req) {
+trace_i915_request_wait_end(struct i915_request *req) {
 	CTR1(KTR_DRM, "request_wait_end req %p", req);
+	SDT_PROBE6(drm, i915, , request_wait_end, req,
+	    req->engine->i915->drm.primary->index,
+	    req->engine->uabi_class, req->engine->uabi_instance,
+	    req->fence.context, req->fence.seqno);
 }
 
 static inline void
@@ -313,8 +348,12 @@ trace_i915_request_execute(void *req) {
 }
 
 static inline void
-trace_i915_request_submit(void *req) {
+trace_i915_request_submit(struct i915_request *req) {
 	CTR1(KTR_DRM, "request_submit req %p", req);
+	SDT_PROBE7(drm, i915, , request_submit, req,
+	    req->engine->i915->drm.primary->index,
+	    req->engine->uabi_class, req->engine->uabi_instance,
+	    req->fence.context, req->fence.seqno, req->tail);
 }
 
 static inline void
@@ -325,11 +364,20 @@ trace_i915_request_queue(struct i915_request *req, uint32_t flags) {
 static inline void
 trace_i915_request_in(struct i915_request *req, uint32_t flags) {
 	CTR2(KTR_DRM, "request_in req %p flags %x", req, flags);
+	SDT_PROBE7(drm, i915, , request_in, req,
+	    req->engine->i915->drm.primary->index,
+	    req->engine->uabi_class, req->engine->uabi_instance,
+	    req->fence.context, req->fence.seqno, flags);
 }
 
 static inline void
 trace_i915_request_out(struct i915_request *req) {
 	CTR1(KTR_DRM, "request_out req %p", req);
+	SDT_PROBE7(drm, i915, , request_out, req,
+	    req->engine->i915->drm.primary->index,
+	    req->engine->uabi_class, req->engine->uabi_instance,
+	    req->fence.context, req->fence.seqno,
+	    i915_request_completed(req));
 }
 
 static inline void
@@ -406,9 +454,11 @@ CTR2(KTR_DRM, "gem_ring_sync_to  to_req %p from %p", to_req, from);
 
 
 static inline void
-trace_i915_vma_bind(void *vma, uint32_t flags)
+trace_i915_vma_bind(struct i915_vma *vma, uint32_t flags)
 {
 	CTR2(KTR_DRM, "vma_bind vma %p flags %x", vma, flags);
+	SDT_PROBE5(drm, i915, , vma_bind, vma->obj, vma->vm, vma->node.start,
+	    vma->node.size, flags);
 }
 
 
@@ -419,9 +469,11 @@ trace_i915_va_alloc(void *vma)
 }
 
 static inline void
-trace_i915_vma_unbind(void *vma)
+trace_i915_vma_unbind(struct i915_vma *vma)
 {
 	CTR1(KTR_DRM, "vma_bind vma %p", vma);
+	SDT_PROBE4(drm, i915, , vma_unbind, vma->obj, vma->vm,
+	    vma->node.start, vma->node.size);
 }
 
 static inline void
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2009 Intel Corporation
+ *
+ * Authors:
+ *    Chris Wilson <chris@chris-wilson.co.uk>
+ */
+
+#include "i915_driver.h"
+#include "i915_trace.h"
+
+#ifndef __CHECKER__
+#define CREATE_TRACE_POINTS
+#include "i915_trace.h"
+#endif
+
+#ifdef __FreeBSD__
+SDT_PROBE_DEFINE7(drm, i915, , request_submit, "struct i915_request *",
+    "uint32_t", "uint16_t", "uint16_t", "uint64_t", "uint64_t", "uint32_t");
+SDT_PROBE_DEFINE7(drm, i915, , request_in, "struct i915_request *",
+    "uint32_t", "uint16_t", "uint16_t", "uint64_t", "uint64_t", "uint32_t");
+SDT_PROBE_DEFINE7(drm, i915, , request_out, "struct i915_request *",
+    "uint32_t", "uint16_t", "uint16_t", "uint64_t", "uint64_t", "bool");
+SDT_PROBE_DEFINE7(drm, i915, , request_wait_begin, "struct i915_request *",
+    "uint32_t", "uint16_t", "uint16_t", "uint64_t", "uint64_t", "uint32_t");
+SDT_PROBE_DEFINE6(drm, i915, , request_wait_end, "struct i915_request *",
+    "uint32_t", "uint16_t", "uint16_t", "uint64_t", "uint64_t");
+SDT_PROBE_DEFINE2(drm, i915, , gem_object_create,
+    "struct drm_i915_gem_object *", "uint64_t");
+SDT_PROBE_DEFINE5(drm, i915, , vma_bind, "struct drm_i915_gem_object *",
+    "struct i915_address_space *", "uint64_t", "uint64_t", "uint32_t");
+SDT_PROBE_DEFINE4(drm, i915, , vma_unbind, "struct drm_i915_gem_object *",
+    "struct i915_address_space *", "uint64_t", "uint64_t");
+SDT_PROBE_DEFINE5(drm, i915, , gem_evict, "uint32_t",
+    "struct i915_address_space *", "uint64_t", "uint64_t", "unsigned int");
+SDT_PROBE_DEFINE6(drm, i915, , gem_evict_node, "uint32_t",
+    "struct i915_address_space *", "uint64_t", "uint64_t", "unsigned long",
+    "unsigned int");
+SDT_PROBE_DEFINE2(drm, i915, , gem_evict_vm, "uint32_t",
+    "struct i915_address_space *");
+#endif
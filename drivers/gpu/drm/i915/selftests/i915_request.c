@@ -508,6 +508,63 @@ out_threads:
 	return ret;
 }
 
+static int mock_request_alloc_throttle(void *arg)
+{
+	static const char * const names[] = {
+		"synchronize_rcu",
+		"cond_synchronize_rcu",
+	};
+	struct drm_i915_private *i915 = arg;
+	struct intel_context *ce = rcs0(i915)->kernel_context;
+	unsigned int pass;
+	int err = 0;
+
+	/*
+	 * Under slab pressure every request allocation goes through
+	 * request_alloc_slow(), which ratelimits the caller against the
+	 * last request on the timeline before retrying. Measure request
+	 * creation throughput with that ratelimit applied to each request,
+	 * once waiting for a full grace period every time and once only
+	 * until the grace period cookie of the previous request expired.
+	 */
+
+	for (pass = 0; pass < ARRAY_SIZE(names); pass++) {
+		IGT_TIMEOUT(end_time);
+		unsigned long cookie, count = 0;
+		struct i915_request *rq;
+		ktime_t dt;
+
+		cookie = get_state_synchronize_rcu();
+		dt = ktime_get_raw();
+		do {
+			if (pass)
+				cond_synchronize_rcu(cookie);
+			else
+				synchronize_rcu();
+
+			rq = mock_request(ce, 0);
+			if (!rq) {
+				err = -ENOMEM;
+				break;
+			}
+			cookie = rq->rcustate;
+			i915_request_add(rq);
+			count++;
+		} while (!__igt_timeout(end_time, NULL));
+		dt = ktime_sub(ktime_get_raw(), dt);
+
+		mock_device_flush(i915);
+		if (err)
+			break;
+
+		pr_info("Request creation throttled by %s: %lu requests in %lluns, %lluns/request\n",
+			names[pass], count, ktime_to_ns(dt),
+			div64_u64(ktime_to_ns(dt), count));
+	}
+
+	return err;
+}
+
 int i915_request_mock_selftests(void)
 {
 	static const struct i915_subtest tests[] = {
@@ -516,6 +573,7 @@ int i915_request_mock_selftests(void)
 		SUBTEST(igt_fence_wait),
 		SUBTEST(igt_request_rewind),
 		SUBTEST(mock_breadcrumbs_smoketest),
+		SUBTEST(mock_request_alloc_throttle),
 	};
 	struct drm_i915_private *i915;
 	intel_wakeref_t wakeref;
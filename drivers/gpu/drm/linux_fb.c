@@ -37,23 +37,34 @@ __FBSDID("$FreeBSD$");
 #include <sys/systm.h>
 #include <sys/sx.h>
 #include <sys/fbio.h>
+#include <sys/kdb.h>
+#include <sys/sysctl.h>
+#include <sys/taskqueue.h>
 
 #include <dev/vt/vt.h>
 #include "vt_drmfb.h"
 
+#include <drm/drm_cache.h>
 #include <drm/drm_fb_helper.h>
 #include <linux/fb.h>
+#include <linux/iosys-map.h>
+#include <linux/uaccess.h>
 #undef fb_info
 #include <drm/drm_os_freebsd.h>
 
 MALLOC_DEFINE(LKPI_FB_MEM, "fb_kms", "FB KMS Data Structures");
 
+SYSCTL_DECL(_hw_dri);
+
 static struct sx linux_fb_mtx;
 SX_SYSINIT(linux_fb_mtx, &linux_fb_mtx, "linux fb");
 
 extern struct vt_device *main_vd;
 
 static int __unregister_framebuffer(struct linux_fb_info *fb_info);
+static void linux_fb_shadow_task(void *arg, int pending);
+static void fb_shadow_alloc(struct linux_fb_info *info);
+static void fb_shadow_free(struct linux_fb_info *info);
 
 void
 vt_freeze_main_vd(struct apertures_struct *a)
@@ -130,6 +141,10 @@ framebuffer_alloc(size_t size, struct device *dev)
 
 	info = malloc(sizeof(*info) + size, LKPI_FB_MEM, M_WAITOK | M_ZERO);
 	TASK_INIT(&info->fb_mode_task, 0, vt_restore_fbdev_mode, info);
+	mtx_init(&info->fb_shadow_mtx, "lkpifbsh", NULL, MTX_DEF);
+	TIMEOUT_TASK_INIT(taskqueue_thread, &info->fb_shadow_task, 0,
+	    linux_fb_shadow_task, info);
+	info->fb_shadow_x1 = info->fb_shadow_y1 = UINT32_MAX;
 
 	if (size)
 		info->par = info + 1;
@@ -144,6 +159,8 @@ framebuffer_release(struct linux_fb_info *info)
 {
 	if (info == NULL)
 		return;
+	fb_shadow_free(info);
+	mtx_destroy(&info->fb_shadow_mtx);
 	kfree(info->apertures);
 	free(info, LKPI_FB_MEM);
 }
@@ -223,6 +240,7 @@ __register_framebuffer(struct linux_fb_info *fb_info)
 		    "fb_bpp not set, setting to 8\n");
 		fb_info->fbio.fb_bpp = 32;
 	}
+	fb_shadow_alloc(fb_info);
 	if ((err = vt_drmfb_attach(&fb_info->fbio)) != 0) {
 		switch (err) {
 		case EEXIST:
@@ -260,6 +278,7 @@ __unregister_framebuffer(struct linux_fb_info *fb_info)
 	int ret = 0;
 
 	vt_drmfb_detach(&fb_info->fbio);
+	fb_shadow_free(fb_info);
 
 	if (fb_info->fbio.fb_fbd_dev) {
 		mtx_lock(&Giant);
@@ -325,34 +344,37 @@ linux_fb_get_options(const char *connector_name, char **option)
  */
 
 static void
-fb_mem_wr1(struct linux_fb_info *info, uint32_t offset, uint8_t value)
+fb_mem_wr1(struct linux_fb_info *info, uint8_t *base, uint32_t offset,
+    uint8_t value)
 {
 	KASSERT(
 	    (offset < info->screen_size),
 	    ("Offset %#08x out of framebuffer size", offset));
-	*(uint8_t *)(info->screen_base + offset) = value;
+	*(uint8_t *)(base + offset) = value;
 }
 
 static void
-fb_mem_wr2(struct linux_fb_info *info, uint32_t offset, uint16_t value)
+fb_mem_wr2(struct linux_fb_info *info, uint8_t *base, uint32_t offset,
+    uint16_t value)
 {
 	KASSERT(
 	    (offset < info->screen_size),
 	    ("Offset %#08x out of framebuffer size", offset));
-	*(uint16_t *)(info->screen_base + offset) = value;
+	*(uint16_t *)(base + offset) = value;
 }
 
 static void
-fb_mem_wr4(struct linux_fb_info *info, uint32_t offset, uint32_t value)
+fb_mem_wr4(struct linux_fb_info *info, uint8_t *base, uint32_t offset,
+    uint32_t value)
 {
 	KASSERT(
 	    (offset < info->screen_size),
 	    ("Offset %#08x out of framebuffer size", offset));
-	*(uint32_t *)(info->screen_base + offset) = value;
+	*(uint32_t *)(base + offset) = value;
 }
 
 static void
-fb_setpixel(struct linux_fb_info *info, uint32_t x, uint32_t y,
+fb_setpixel(struct linux_fb_info *info, uint8_t *base, uint32_t x, uint32_t y,
     uint32_t color)
 {
 	uint32_t bytes_per_pixel;
@@ -361,22 +383,22 @@ fb_setpixel(struct linux_fb_info *info, uint32_t x, uint32_t y,
 	bytes_per_pixel = info->var.bits_per_pixel / 8;
 	offset = info->fix.line_length * y + x * bytes_per_pixel;
 
-	KASSERT((info->screen_base != 0), ("Unmapped framebuffer"));
+	KASSERT((base != 0), ("Unmapped framebuffer"));
 
 	switch (bytes_per_pixel) {
 	case 1:
-		fb_mem_wr1(info, offset, color);
+		fb_mem_wr1(info, base, offset, color);
 		break;
 	case 2:
-		fb_mem_wr2(info, offset, color);
+		fb_mem_wr2(info, base, offset, color);
 		break;
 	case 3:
-		fb_mem_wr1(info, offset, (color >> 16) & 0xff);
-		fb_mem_wr1(info, offset + 1, (color >> 8) & 0xff);
-		fb_mem_wr1(info, offset + 2, color & 0xff);
+		fb_mem_wr1(info, base, offset, (color >> 16) & 0xff);
+		fb_mem_wr1(info, base, offset + 1, (color >> 8) & 0xff);
+		fb_mem_wr1(info, base, offset + 2, color & 0xff);
 		break;
 	case 4:
-		fb_mem_wr4(info, offset, color);
+		fb_mem_wr4(info, base, offset, color);
 		break;
 	default:
 		/* panic? */
@@ -384,44 +406,517 @@ fb_setpixel(struct linux_fb_info *info, uint32_t x, uint32_t y,
 	}
 }
 
+/*
+ * Row-oriented drawing engine.
+ *
+ * The framebuffer is usually uncached or write-combined VRAM, so storing it
+ * one pixel at a time through fb_setpixel() is very slow on large consoles.
+ * Instead, each scanline (or a chunk of it) is rendered into a small cached
+ * staging buffer on the stack and then pushed out with 64-bit stores, which
+ * are non-temporal where the CPU supports them.
+ *
+ * The staging buffer size is a multiple of 24 bytes so that a row of any
+ * pixel size can be repeated across a scanline without breaking the pattern,
+ * and holds a multiple of 8 pixels so that glyph rows expand byte by byte.
+ */
+#define	FB_STAGE_BYTES	384
+
+/*
+ * Glyph expansion tables: each entry holds 64 bits worth of pixels where the
+ * pixels corresponding to set bits of the index are all ones.  Pixel 0 maps to
+ * the most significant bit, matching the layout of `struct fb_image` data.
+ */
+static uint64_t fb_expand8[256];	/* 8 pixels per glyph byte */
+static uint64_t fb_expand16[16];	/* 4 pixels per glyph nibble */
+static uint64_t fb_expand32[4];		/* 2 pixels per glyph bit pair */
+
+union fb_word {
+	uint64_t	w;
+	uint32_t	d[2];
+	uint16_t	h[4];
+	uint8_t		b[8];
+};
+
+static void
+fb_expand_init(void *arg __unused)
+{
+	union fb_word u;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		for (j = 0; j < 8; j++)
+			u.b[j] = (i & (0x80 >> j)) ? 0xff : 0;
+		fb_expand8[i] = u.w;
+	}
+	for (i = 0; i < 16; i++) {
+		for (j = 0; j < 4; j++)
+			u.h[j] = (i & (0x8 >> j)) ? 0xffff : 0;
+		fb_expand16[i] = u.w;
+	}
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 2; j++)
+			u.d[j] = (i & (0x2 >> j)) ? 0xffffffff : 0;
+		fb_expand32[i] = u.w;
+	}
+}
+SYSINIT(linux_fb_expand, SI_SUB_DRIVERS, SI_ORDER_ANY, fb_expand_init, NULL);
+
+/* Replicate a pixel value over a 64-bit word. */
+static inline uint64_t
+fb_pattern(uint32_t bytes_per_pixel, uint32_t color)
+{
+	union fb_word u;
+
+	switch (bytes_per_pixel) {
+	case 1:
+		memset(u.b, color, sizeof(u.b));
+		break;
+	case 2:
+		u.h[0] = u.h[1] = u.h[2] = u.h[3] = color;
+		break;
+	default:
+		u.d[0] = u.d[1] = color;
+		break;
+	}
+	return (u.w);
+}
+
+static inline void
+fb_stream_wr8(uint8_t *dst, uint64_t value)
+{
+#if defined(__amd64__)
+	__asm __volatile("movnti %1, %0" : "=m" (*(uint64_t *)dst) : "r" (value));
+#else
+	*(volatile uint64_t *)dst = value;
+#endif
+}
+
+/* Order the non-temporal stores issued by fb_stream_wr8(). */
+static inline void
+fb_stream_fence(void)
+{
+#if defined(__amd64__)
+	__asm __volatile("sfence" ::: "memory");
+#endif
+}
+
+/*
+ * Copy `len` bytes of cached memory to the framebuffer.  All stores are
+ * naturally aligned so that this is safe for device memory mappings.
+ */
+static void
+fb_copyout(uint8_t *dst, const uint8_t *src, size_t len)
+{
+	uint64_t v8;
+	uint32_t v4;
+	uint16_t v2;
+
+	if (((uintptr_t)dst & 1) != 0 && len >= 1) {
+		*(volatile uint8_t *)dst = *src;
+		dst += 1; src += 1; len -= 1;
+	}
+	if (((uintptr_t)dst & 2) != 0 && len >= 2) {
+		memcpy(&v2, src, 2);
+		*(volatile uint16_t *)dst = v2;
+		dst += 2; src += 2; len -= 2;
+	}
+	if (((uintptr_t)dst & 4) != 0 && len >= 4) {
+		memcpy(&v4, src, 4);
+		*(volatile uint32_t *)dst = v4;
+		dst += 4; src += 4; len -= 4;
+	}
+	for (; len >= 8; dst += 8, src += 8, len -= 8) {
+		memcpy(&v8, src, 8);
+		fb_stream_wr8(dst, v8);
+	}
+	if (len >= 4) {
+		memcpy(&v4, src, 4);
+		*(volatile uint32_t *)dst = v4;
+		dst += 4; src += 4; len -= 4;
+	}
+	if (len >= 2) {
+		memcpy(&v2, src, 2);
+		*(volatile uint16_t *)dst = v2;
+		dst += 2; src += 2; len -= 2;
+	}
+	if (len >= 1)
+		*(volatile uint8_t *)dst = *src;
+}
+
+/*
+ * Copy `len` bytes from the framebuffer to cached memory, with naturally
+ * aligned loads.  Uncached reads are expensive, so they are done 64 bits at a
+ * time whenever possible.
+ */
+static void
+fb_copyin(uint8_t *dst, const uint8_t *src, size_t len)
+{
+	uint64_t v8;
+	uint32_t v4;
+	uint16_t v2;
+
+	if (((uintptr_t)src & 1) != 0 && len >= 1) {
+		*dst = *(const volatile uint8_t *)src;
+		dst += 1; src += 1; len -= 1;
+	}
+	if (((uintptr_t)src & 2) != 0 && len >= 2) {
+		v2 = *(const volatile uint16_t *)src;
+		memcpy(dst, &v2, 2);
+		dst += 2; src += 2; len -= 2;
+	}
+	if (((uintptr_t)src & 4) != 0 && len >= 4) {
+		v4 = *(const volatile uint32_t *)src;
+		memcpy(dst, &v4, 4);
+		dst += 4; src += 4; len -= 4;
+	}
+	for (; len >= 8; dst += 8, src += 8, len -= 8) {
+		v8 = *(const volatile uint64_t *)src;
+		memcpy(dst, &v8, 8);
+	}
+	if (len >= 4) {
+		v4 = *(const volatile uint32_t *)src;
+		memcpy(dst, &v4, 4);
+		dst += 4; src += 4; len -= 4;
+	}
+	if (len >= 2) {
+		v2 = *(const volatile uint16_t *)src;
+		memcpy(dst, &v2, 2);
+		dst += 2; src += 2; len -= 2;
+	}
+	if (len >= 1)
+		*dst = *(const volatile uint8_t *)src;
+}
+
+/*
+ * Clip a copyarea request so that both the source and the destination
+ * rectangles lie within the visible area.  Returns false if nothing is left.
+ */
+static bool
+fb_clip_copyarea(struct linux_fb_info *info, const struct fb_copyarea *area,
+    uint32_t *width, uint32_t *height)
+{
+
+	if (area->dx >= info->var.xres || area->sx >= info->var.xres ||
+	    area->dy >= info->var.yres || area->sy >= info->var.yres)
+		return (false);
+
+	*width = MIN(area->width,
+	    info->var.xres - MAX(area->dx, area->sx));
+	*height = MIN(area->height,
+	    info->var.yres - MAX(area->dy, area->sy));
+	return (*width != 0 && *height != 0);
+}
+
+static inline uint8_t *
+fb_pixel_addr(struct linux_fb_info *info, uint8_t *base, uint32_t x,
+    uint32_t y)
+{
+
+	return (base + info->fix.line_length * y +
+	    x * (info->var.bits_per_pixel / 8));
+}
+
+/*
+ * Write out a staged row, either to cached memory (system memory framebuffer
+ * or shadow) or to VRAM.
+ */
+static inline void
+fb_rowout(uint8_t *dst, const uint8_t *src, size_t len, bool cached)
+{
+
+	if (cached)
+		memcpy(dst, src, len);
+	else
+		fb_copyout(dst, src, len);
+}
+
+/* Move a clipped area within a framebuffer in cached memory. */
+static void
+fb_move_area(struct linux_fb_info *info, uint8_t *base,
+    const struct fb_copyarea *area, uint32_t width, uint32_t height)
+{
+	uint8_t *dst, *src;
+	uint32_t y;
+	size_t len;
+	int pitch;
+
+	/* memmove() handles overlap within a row, order handles the rest. */
+	len = (size_t)width * (info->var.bits_per_pixel / 8);
+	pitch = info->fix.line_length;
+	dst = fb_pixel_addr(info, base, area->dx, area->dy);
+	src = fb_pixel_addr(info, base, area->sx, area->sy);
+	if (area->dy > area->sy) {
+		dst += (height - 1) * pitch;
+		src += (height - 1) * pitch;
+		pitch = -pitch;
+	}
+	for (y = 0; y < height; y++, dst += pitch, src += pitch)
+		memmove(dst, src, len);
+}
+
+/*
+ * Shadow framebuffer.
+ *
+ * When enabled with the hw.dri.fb_shadow tunable, the cfb_*() ops draw into a
+ * copy of the framebuffer in cached system memory and only record the
+ * damaged area.  The damage is written to VRAM at most hw.dri.fb_shadow_hz
+ * times per second from taskqueue_thread, or synchronously when the
+ * scheduler is not available (kdb, panic).  Reads done by copyarea are then
+ * served from cached memory too.  System memory framebuffers (FBINFO_VIRTFB)
+ * get no shadow.
+ */
+static int linux_fb_shadow_enable = 0;
+SYSCTL_INT(_hw_dri, OID_AUTO, fb_shadow, CTLFLAG_RDTUN,
+    &linux_fb_shadow_enable, 0,
+    "Draw the console into a cached shadow of the framebuffer");
+
+static int linux_fb_shadow_hz = 60;
+SYSCTL_INT(_hw_dri, OID_AUTO, fb_shadow_hz, CTLFLAG_RWTUN,
+    &linux_fb_shadow_hz, 0,
+    "Maximum number of shadow framebuffer flushes per second");
+
 void
-cfb_fillrect(struct linux_fb_info *info, const struct fb_fillrect *rect)
+linux_fb_shadow_flush(struct linux_fb_info *info)
 {
-	uint32_t x, y;
+	uint32_t bytes_per_pixel, x1, y1, x2, y2, y;
+	size_t off, len;
 
-	if (info->fbio.fb_flags & FB_FLAG_NOWRITE)
+	if (info->fb_shadow == NULL)
 		return;
 
-	KASSERT(
-	    (rect->rop == ROP_COPY),
-	    ("`rect->rop=%u` is unsupported in cfb_fillrect()", rect->rop));
+	mtx_lock(&info->fb_shadow_mtx);
+	x1 = info->fb_shadow_x1;
+	y1 = info->fb_shadow_y1;
+	x2 = info->fb_shadow_x2;
+	y2 = info->fb_shadow_y2;
+	info->fb_shadow_x1 = info->fb_shadow_y1 = UINT32_MAX;
+	info->fb_shadow_x2 = info->fb_shadow_y2 = 0;
+	mtx_unlock(&info->fb_shadow_mtx);
+
+	if (x1 >= x2 || y1 >= y2 ||
+	    (info->fbio.fb_flags & FB_FLAG_NOWRITE) != 0)
+		return;
+
+	bytes_per_pixel = info->var.bits_per_pixel / 8;
+	len = (size_t)(x2 - x1) * bytes_per_pixel;
+	off = (size_t)y1 * info->fix.line_length + x1 * bytes_per_pixel;
+	for (y = y1; y < y2; y++, off += info->fix.line_length)
+		fb_copyout((uint8_t *)info->screen_base + off,
+		    info->fb_shadow + off, len);
+	fb_stream_fence();
+}
+
+static void
+linux_fb_shadow_task(void *arg, int pending)
+{
+
+	linux_fb_shadow_flush(arg);
+}
+
+static void
+fb_shadow_damage(struct linux_fb_info *info, uint32_t x, uint32_t y,
+    uint32_t width, uint32_t height)
+{
+
+	if (info->fb_shadow == NULL ||
+	    x >= info->var.xres || y >= info->var.yres)
+		return;
+
+	mtx_lock(&info->fb_shadow_mtx);
+	info->fb_shadow_x1 = MIN(info->fb_shadow_x1, x);
+	info->fb_shadow_y1 = MIN(info->fb_shadow_y1, y);
+	info->fb_shadow_x2 = MAX(info->fb_shadow_x2,
+	    x + MIN(width, info->var.xres - x));
+	info->fb_shadow_y2 = MAX(info->fb_shadow_y2,
+	    y + MIN(height, info->var.yres - y));
+	mtx_unlock(&info->fb_shadow_mtx);
+
+	if (kdb_active || KERNEL_PANICKED()) {
+		linux_fb_shadow_flush(info);
+		return;
+	}
+
+	/*
+	 * A negative count leaves an already scheduled flush at its deadline
+	 * instead of pushing it back, that flush picks up this damage too.
+	 */
+	taskqueue_enqueue_timeout(taskqueue_thread, &info->fb_shadow_task,
+	    -MAX(hz / MAX(linux_fb_shadow_hz, 1), 1));
+}
+
+static void
+fb_shadow_alloc(struct linux_fb_info *info)
+{
+
+	if (!linux_fb_shadow_enable || info->screen_base == NULL ||
+	    info->fb_shadow != NULL)
+		return;
+
+	/*
+	 * Framebuffers in system memory are drawn by the sys_*() ops straight
+	 * into screen_buffer, a cached copy only pays off in front of iomem.
+	 */
+	if ((info->flags & FBINFO_VIRTFB) != 0)
+		return;
+
+	info->fb_shadow_size = (size_t)info->fix.line_length * info->var.yres;
+	info->fb_shadow = malloc(info->fb_shadow_size, LKPI_FB_MEM,
+	    M_WAITOK | M_ZERO);
+}
+
+static void
+fb_shadow_free(struct linux_fb_info *info)
+{
+	uint8_t *shadow;
+
+	if (info->fb_shadow == NULL)
+		return;
+
+	if (taskqueue_cancel_timeout(taskqueue_thread,
+	    &info->fb_shadow_task, NULL) != 0)
+		taskqueue_drain_timeout(taskqueue_thread,
+		    &info->fb_shadow_task);
+	linux_fb_shadow_flush(info);
+
+	shadow = info->fb_shadow;
+	info->fb_shadow = NULL;
+	free(shadow, LKPI_FB_MEM);
+}
 
-	for (y = rect->dy; y < rect->dy + rect->height; ++y) {
-		for (x = rect->dx; x < rect->dx + rect->width; ++x) {
-			fb_setpixel(info, x, y, rect->color);
+/* Fill `count` pixels of the staging buffer with `color`. */
+static void
+fb_stage_fill(uint64_t *stage, uint32_t bytes_per_pixel, uint32_t color,
+    uint32_t count)
+{
+	uint8_t *p;
+	uint64_t pat;
+	uint32_t i;
+
+	if (bytes_per_pixel == 3) {
+		p = (uint8_t *)stage;
+		for (i = 0; i < count; i++, p += 3) {
+			p[0] = (color >> 16) & 0xff;
+			p[1] = (color >> 8) & 0xff;
+			p[2] = color & 0xff;
 		}
+		return;
 	}
+
+	pat = fb_pattern(bytes_per_pixel, color);
+	for (i = 0; i < howmany(count * bytes_per_pixel, 8); i++)
+		stage[i] = pat;
 }
 
-void
-cfb_copyarea(struct linux_fb_info *info, const struct fb_copyarea *area)
+/*
+ * Expand `count` pixels of a 1bpp glyph row into the staging buffer.  `count`
+ * is rounded up to a whole glyph byte; the caller only copies out what it
+ * needs.
+ */
+static void
+fb_stage_expand(uint64_t *stage, uint32_t bytes_per_pixel, const uint8_t *src,
+    uint32_t count, uint32_t fg, uint32_t bg)
 {
-	panic("cfb_copyarea() not implemented");
+	uint64_t fgx, bgx, eor;
+	uint32_t color, i, j;
+	uint8_t *p;
+	uint8_t byte;
+
+	if (bytes_per_pixel == 3) {
+		p = (uint8_t *)stage;
+		for (i = 0; i < count; i++, p += 3) {
+			color = src[i / 8] & (0x80 >> (i % 8)) ? fg : bg;
+			p[0] = (color >> 16) & 0xff;
+			p[1] = (color >> 8) & 0xff;
+			p[2] = color & 0xff;
+		}
+		return;
+	}
+
+	fgx = fb_pattern(bytes_per_pixel, fg);
+	bgx = fb_pattern(bytes_per_pixel, bg);
+	eor = fgx ^ bgx;
+
+	for (i = 0; i < howmany(count, 8); i++) {
+		byte = src[i];
+		switch (bytes_per_pixel) {
+		case 1:
+			*stage++ = bgx ^ (fb_expand8[byte] & eor);
+			break;
+		case 2:
+			*stage++ = bgx ^ (fb_expand16[byte >> 4] & eor);
+			*stage++ = bgx ^ (fb_expand16[byte & 0xf] & eor);
+			break;
+		case 4:
+			for (j = 0; j < 8; j += 2)
+				*stage++ = bgx ^
+				    (fb_expand32[(byte >> (6 - j)) & 0x3] & eor);
+			break;
+		}
+	}
 }
 
-void
-cfb_imageblit(struct linux_fb_info *info, const struct fb_image *image)
+static void
+fb_fillrect_to(struct linux_fb_info *info, uint8_t *base, bool cached,
+    const struct fb_fillrect *rect)
 {
-	uint32_t x, y, width, height, xi, yi;
-	uint32_t bytes_per_img_line, bit, byte, color;
+	uint64_t stage[FB_STAGE_BYTES / sizeof(uint64_t)];
+	uint32_t bytes_per_pixel, width, height, y;
+	size_t chunk, len, off;
+	uint8_t *dst;
 
-	if (info->fbio.fb_flags & FB_FLAG_NOWRITE)
+	KASSERT(
+	    (rect->rop == ROP_COPY),
+	    ("`rect->rop=%u` is unsupported in cfb_fillrect()", rect->rop));
+	KASSERT((base != 0), ("Unmapped framebuffer"));
+
+	bytes_per_pixel = info->var.bits_per_pixel / 8;
+	if (bytes_per_pixel < 1 || bytes_per_pixel > 4)
 		return;
 
+	if (rect->dx >= info->var.xres || rect->dy >= info->var.yres)
+		return;
+	width = MIN(rect->width, info->var.xres - rect->dx);
+	height = MIN(rect->height, info->var.yres - rect->dy);
+
+	/*
+	 * Render as much of one row as fits in the staging buffer once, then
+	 * repeat it along every scanline of the rectangle.
+	 */
+	len = (size_t)width * bytes_per_pixel;
+	chunk = MIN(len, FB_STAGE_BYTES);
+	fb_stage_fill(stage, bytes_per_pixel, rect->color,
+	    chunk / bytes_per_pixel);
+
+	dst = fb_pixel_addr(info, base, rect->dx, rect->dy);
+	for (y = 0; y < height; y++, dst += info->fix.line_length) {
+		for (off = 0; off < len; off += chunk)
+			fb_rowout(dst + off, (uint8_t *)stage,
+			    MIN(chunk, len - off), cached);
+	}
+	if (!cached)
+		fb_stream_fence();
+}
+
+static void
+fb_imageblit_to(struct linux_fb_info *info, uint8_t *base, bool cached,
+    const struct fb_image *image)
+{
+	uint64_t stage[FB_STAGE_BYTES / sizeof(uint64_t)];
+	uint32_t x, y, width, height, xi, yi;
+	uint32_t bytes_per_img_line, bit, byte, color;
+	uint32_t bytes_per_pixel, chunk, count;
+	const uint8_t *src;
+	uint8_t *dst;
+
 	KASSERT(
 	    (image->depth == 1),
 	    ("`image->depth=%u` is unsupported in cfb_imageblit()",
 	     image->depth));
+	KASSERT((base != 0), ("Unmapped framebuffer"));
+
+	bytes_per_pixel = info->var.bits_per_pixel / 8;
+	if (bytes_per_pixel < 1 || bytes_per_pixel > 4)
+		return;
 
 	bytes_per_img_line = (image->width + 7) / 8;
 
@@ -442,17 +937,28 @@ cfb_imageblit(struct linux_fb_info *info, const struct fb_image *image)
 	}
 
 	if (image->mask == NULL) {
+		/* Pixels per staging pass, always a whole number of bytes. */
+		chunk = rounddown2(FB_STAGE_BYTES / bytes_per_pixel, 8);
 		for (yi = 0; yi < height; ++yi) {
-			for (xi = 0; xi < width; ++xi) {
-				byte = yi * bytes_per_img_line + xi / 8;
-				bit = 0x80 >> (xi % 8);
-				color = image->data[byte] & bit ?
-				    image->fg_color : image->bg_color;
-
-				fb_setpixel(info, x + xi, y + yi, color);
+			src = image->data + yi * bytes_per_img_line;
+			dst = fb_pixel_addr(info, base, x, y + yi);
+			for (xi = 0; xi < width; xi += chunk) {
+				count = MIN(chunk, width - xi);
+				fb_stage_expand(stage, bytes_per_pixel,
+				    src + xi / 8, count,
+				    image->fg_color, image->bg_color);
+				fb_rowout(dst + xi * bytes_per_pixel,
+				    (uint8_t *)stage, count * bytes_per_pixel,
+				    cached);
 			}
 		}
+		if (!cached)
+			fb_stream_fence();
 	} else {
+		/*
+		 * Only used for the mouse pointer: a handful of pixels where
+		 * the framebuffer contents must be preserved outside the mask.
+		 */
 		for (yi = 0; yi < height; ++yi) {
 			for (xi = 0; xi < width; ++xi) {
 				byte = yi * bytes_per_img_line + xi / 8;
@@ -460,43 +966,269 @@ cfb_imageblit(struct linux_fb_info *info, const struct fb_image *image)
 				if (image->mask[byte] & bit) {
 					color = image->fg_color;
 
-					fb_setpixel(info, x + xi, y + yi, color);
+					fb_setpixel(info, base, x + xi, y + yi,
+					    color);
 				}
 			}
 		}
 	}
 }
 
+void
+cfb_fillrect(struct linux_fb_info *info, const struct fb_fillrect *rect)
+{
+
+	if (info->fbio.fb_flags & FB_FLAG_NOWRITE)
+		return;
+
+	if (info->fb_shadow != NULL) {
+		fb_fillrect_to(info, info->fb_shadow, true, rect);
+		fb_shadow_damage(info, rect->dx, rect->dy, rect->width,
+		    rect->height);
+	} else
+		fb_fillrect_to(info, (uint8_t *)info->screen_base, false, rect);
+}
+
+void
+cfb_copyarea(struct linux_fb_info *info, const struct fb_copyarea *area)
+{
+	uint64_t stage[FB_STAGE_BYTES / sizeof(uint64_t)];
+	uint32_t bytes_per_pixel, width, height, y;
+	size_t chunk, len, off;
+	uint8_t *dst, *src;
+	int pitch;
+
+	if (info->fbio.fb_flags & FB_FLAG_NOWRITE)
+		return;
+
+	KASSERT((info->screen_base != 0), ("Unmapped framebuffer"));
+
+	bytes_per_pixel = info->var.bits_per_pixel / 8;
+	if (bytes_per_pixel < 1 || bytes_per_pixel > 4)
+		return;
+	if (!fb_clip_copyarea(info, area, &width, &height))
+		return;
+
+	/* Both ends of the copy are in cached memory with a shadow. */
+	if (info->fb_shadow != NULL) {
+		fb_move_area(info, info->fb_shadow, area, width, height);
+		fb_shadow_damage(info, area->dx, area->dy, width, height);
+		return;
+	}
+
+	/*
+	 * Walk the scanlines away from the overlap: bottom-up when moving
+	 * down, top-down otherwise.  Within a scanline, each chunk is read
+	 * entirely into the staging buffer before being written back, and
+	 * chunks are walked right-to-left when moving right for the same
+	 * reason.
+	 */
+	len = (size_t)width * bytes_per_pixel;
+	chunk = MIN(len, FB_STAGE_BYTES);
+	pitch = info->fix.line_length;
+	dst = fb_pixel_addr(info, (uint8_t *)info->screen_base,
+	    area->dx, area->dy);
+	src = fb_pixel_addr(info, (uint8_t *)info->screen_base,
+	    area->sx, area->sy);
+	if (area->dy > area->sy) {
+		dst += (height - 1) * pitch;
+		src += (height - 1) * pitch;
+		pitch = -pitch;
+	}
+
+	for (y = 0; y < height; y++, dst += pitch, src += pitch) {
+		if (area->dy == area->sy && area->dx > area->sx) {
+			for (off = rounddown(len - 1, chunk);; off -= chunk) {
+				fb_copyin((uint8_t *)stage, src + off,
+				    MIN(chunk, len - off));
+				fb_copyout(dst + off, (uint8_t *)stage,
+				    MIN(chunk, len - off));
+				if (off == 0)
+					break;
+			}
+		} else {
+			for (off = 0; off < len; off += chunk) {
+				fb_copyin((uint8_t *)stage, src + off,
+				    MIN(chunk, len - off));
+				fb_copyout(dst + off, (uint8_t *)stage,
+				    MIN(chunk, len - off));
+			}
+		}
+	}
+	fb_stream_fence();
+}
+
+void
+cfb_imageblit(struct linux_fb_info *info, const struct fb_image *image)
+{
+
+	if (info->fbio.fb_flags & FB_FLAG_NOWRITE)
+		return;
+
+	if (info->fb_shadow != NULL) {
+		fb_imageblit_to(info, info->fb_shadow, true, image);
+		fb_shadow_damage(info, image->dx, image->dy, image->width,
+		    image->height);
+	} else
+		fb_imageblit_to(info, (uint8_t *)info->screen_base, false,
+		    image);
+}
+
 void
 sys_fillrect(struct linux_fb_info *info, const struct fb_fillrect *rect)
 {
-	cfb_fillrect(info, rect);
+
+	if (info->fbio.fb_flags & FB_FLAG_NOWRITE)
+		return;
+
+	fb_fillrect_to(info, (uint8_t *)info->screen_buffer, true, rect);
 }
 
 void
 sys_copyarea(struct linux_fb_info *info, const struct fb_copyarea *area)
 {
-	cfb_copyarea(info, area);
+	uint32_t width, height;
+
+	if (info->fbio.fb_flags & FB_FLAG_NOWRITE)
+		return;
+
+	/* The framebuffer is in system RAM already. */
+	if (fb_clip_copyarea(info, area, &width, &height))
+		fb_move_area(info, (uint8_t *)info->screen_buffer, area, width,
+		    height);
 }
 
 void
 sys_imageblit(struct linux_fb_info *info, const struct fb_image *image)
 {
-	cfb_imageblit(info, image);
+
+	if (info->fbio.fb_flags & FB_FLAG_NOWRITE)
+		return;
+
+	fb_imageblit_to(info, (uint8_t *)info->screen_buffer, true, image);
+}
+
+/*
+ * Size of the fbdev memory as seen through read(2)/write(2).
+ */
+static size_t
+fb_sys_size(struct linux_fb_info *info)
+{
+
+	return (info->screen_size != 0 ? info->screen_size :
+	    info->fix.smem_len);
 }
 
 ssize_t
 fb_sys_read(struct linux_fb_info *info, char __user *buf,
     size_t count, loff_t *ppos)
 {
-	panic("fb_sys_read() not implemented");
-	return (0);
+	struct iosys_map dst, src;
+	size_t total_size, c, n;
+	loff_t pos = *ppos;
+	ssize_t ret = 0;
+	uint8_t *from;
+	void *bounce;
+	bool fast;
+
+	total_size = fb_sys_size(info);
+	if (info->screen_buffer == NULL || pos < 0 || pos >= total_size)
+		return (0);
+	count = MIN(count, total_size - pos);
+
+	if (info->fbops->fb_sync)
+		info->fbops->fb_sync(info);
+
+	/*
+	 * Copy out in page sized chunks.  Cached memory goes straight to
+	 * userspace; a framebuffer which may be write-combined is bounced
+	 * through a page with drm_memcpy_from_wc(), the first chunk being
+	 * shortened so that the following ones are 16-byte aligned.
+	 */
+	bounce = malloc(PAGE_SIZE, LKPI_FB_MEM, M_WAITOK);
+	iosys_map_set_vaddr(&dst, bounce);
+	fast = (info->flags & FBINFO_READS_FAST) != 0;
+	while (count > 0) {
+		from = (uint8_t *)info->screen_buffer + pos;
+		c = MIN(count, ((uintptr_t)from & 15) != 0 ?
+		    16 - ((uintptr_t)from & 15) : PAGE_SIZE);
+
+		if (!fast) {
+			n = rounddown2(c, 16);
+			if (n != 0) {
+				iosys_map_set_vaddr(&src, from);
+				drm_memcpy_from_wc(&dst, &src, n);
+			}
+			if (c > n)
+				memcpy((uint8_t *)bounce + n, from + n, c - n);
+			from = bounce;
+		}
+		if (copy_to_user(buf, from, c) != 0) {
+			if (ret == 0)
+				ret = -EFAULT;
+			break;
+		}
+
+		buf += c;
+		pos += c;
+		ret += c;
+		count -= c;
+	}
+	free(bounce, LKPI_FB_MEM);
+
+	if (ret > 0)
+		*ppos = pos;
+	return (ret);
 }
 
 ssize_t
 fb_sys_write(struct linux_fb_info *info, const char __user *buf,
     size_t count, loff_t *ppos)
 {
-	panic("fb_sys_write() not implemented");
-	return (0);
+	size_t total_size, c;
+	loff_t pos = *ppos;
+	ssize_t ret = 0;
+	uint8_t *to;
+	int err = 0;
+
+	total_size = fb_sys_size(info);
+	if (info->screen_buffer == NULL || pos < 0)
+		return (-EINVAL);
+	if (pos > total_size)
+		return (-EFBIG);
+	if (count > total_size) {
+		err = -EFBIG;
+		count = total_size;
+	}
+	if (total_size - count < pos) {
+		if (err == 0)
+			err = -ENOSPC;
+		count = total_size - pos;
+	}
+
+	if (info->fbops->fb_sync)
+		info->fbops->fb_sync(info);
+
+	/*
+	 * Like the sys_*() drawing ops this only ever touches screen_buffer,
+	 * system memory framebuffers have no console shadow.
+	 */
+	while (count > 0) {
+		to = (uint8_t *)info->screen_buffer + pos;
+		c = MIN(count, PAGE_SIZE);
+
+		if (copy_from_user(to, buf, c) != 0) {
+			err = -EFAULT;
+			break;
+		}
+
+		buf += c;
+		pos += c;
+		ret += c;
+		count -= c;
+	}
+
+	if (ret > 0)
+		*ppos = pos;
+	return (ret > 0 ? ret : err);
 }
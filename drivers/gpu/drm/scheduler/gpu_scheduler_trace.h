@@ -26,24 +26,49 @@
 
 #ifdef __FreeBSD__
 
+#include <sys/sdt.h>
+
+/*
+ * drm:sched:: probes, defined in sched_main.c.  The arguments carry the
+ * TP_STRUCT__entry fields of the Linux events below.
+ */
+SDT_PROVIDER_DECLARE(drm);
+SDT_PROBE_DECLARE(drm, sched, , sched_job);
+SDT_PROBE_DECLARE(drm, sched, , run_job);
+SDT_PROBE_DECLARE(drm, sched, , process_job);
+SDT_PROBE_DECLARE(drm, sched, , job_wait_dep);
+
+#define	DRM_SCHED_JOB_SDT_PROBE(name, sched_job, entity)		\
+	SDT_PROBE7(drm, sched, , name, (sched_job), (entity),		\
+	    &(sched_job)->s_fence->finished, (sched_job)->sched->name,	\
+	    (sched_job)->id, spsc_queue_count(&(entity)->job_queue),	\
+	    atomic_read(&(sched_job)->sched->hw_rq_count))
+
 static inline void
-trace_drm_sched_job(void *sched_job, void *entity) {
+trace_drm_sched_job(struct drm_sched_job *sched_job,
+    struct drm_sched_entity *entity) {
 	CTR2(KTR_DRM, "drm_sched_job %p, entity %p", sched_job, entity);
+	DRM_SCHED_JOB_SDT_PROBE(sched_job, sched_job, entity);
 }
 
 static inline void
-trace_drm_run_job(void *sched_job, void *entity) {
+trace_drm_run_job(struct drm_sched_job *sched_job,
+    struct drm_sched_entity *entity) {
 	CTR2(KTR_DRM, "drm_sched_job %p, entity %p", sched_job, entity);
+	DRM_SCHED_JOB_SDT_PROBE(run_job, sched_job, entity);
 }
 
 static inline void
 trace_drm_sched_job_wait_dep(struct drm_sched_job *job, struct dma_fence *fence) {
 	CTR2(KTR_DRM, "drm_process_wait_job %p fence %p", job, fence);
+	SDT_PROBE6(drm, sched, , job_wait_dep, job, job->sched->name,
+	    job->id, fence, fence->context, fence->seqno);
 }
 
 static inline void
-trace_drm_sched_process_job(void *s_fence) {
+trace_drm_sched_process_job(struct drm_sched_fence *s_fence) {
 	CTR1(KTR_DRM, "drm_process_sched_job %p", s_fence);
+	SDT_PROBE2(drm, sched, , process_job, s_fence, &s_fence->finished);
 }
 
 #else
@@ -67,6 +67,7 @@ int drm_sched_entity_init(struct drm_sched_entity *entity,
 
 	memset(entity, 0, sizeof(struct drm_sched_entity));
 	INIT_LIST_HEAD(&entity->list);
+	RB_CLEAR_NODE(&entity->rb_node);
 	entity->rq = NULL;
 	entity->guilty = guilty;
 	entity->num_sched_list = num_sched_list;
@@ -88,6 +89,26 @@ int drm_sched_entity_init(struct drm_sched_entity *entity,
 	atomic_set(&entity->fence_seq, 0);
 	entity->fence_context = dma_fence_context_alloc(2);
 
+	if (num_sched_list &&
+	    sched_list[0]->policy == DRM_SCHED_POLICY_VRUNTIME) {
+		entity->stats = kzalloc(sizeof(*entity->stats), GFP_KERNEL);
+		if (!entity->stats)
+			return -ENOMEM;
+		kref_init(&entity->stats->refcount);
+	}
+
+#ifdef __FreeBSD__
+	entity->lat = kzalloc(sizeof(*entity->lat), GFP_KERNEL);
+	if (!entity->lat) {
+		kfree(entity->stats);
+		entity->stats = NULL;
+		return -ENOMEM;
+	}
+	drm_sched_lat_init(entity->lat,
+			   num_sched_list ? sched_list[0]->dev : NULL,
+			   num_sched_list ? sched_list[0]->name : NULL, true);
+#endif
+
 	return 0;
 }
 EXPORT_SYMBOL(drm_sched_entity_init);
@@ -326,6 +347,19 @@ void drm_sched_entity_fini(struct drm_sched_entity *entity)
 
 	dma_fence_put(entity->last_scheduled);
 	entity->last_scheduled = NULL;
+
+	if (entity->stats) {
+		drm_sched_entity_stats_put(entity->stats);
+		entity->stats = NULL;
+	}
+
+#ifdef __FreeBSD__
+	if (entity->lat) {
+		drm_sched_lat_fini(entity->lat);
+		drm_sched_lat_put(entity->lat);
+		entity->lat = NULL;
+	}
+#endif
 }
 EXPORT_SYMBOL(drm_sched_entity_fini);
 
@@ -349,9 +383,20 @@ static void drm_sched_entity_clear_dep(struct dma_fence *f,
 {
 	struct drm_sched_entity *entity =
 		container_of(cb, struct drm_sched_entity, cb);
+#ifdef __FreeBSD__
+	ktime_t now = ktime_get();
+
+	drm_sched_lat_account(entity->lat, DRM_SCHED_LAT_DEP,
+			      entity->lat_dep_start, now);
+	drm_sched_lat_account(&entity->rq->sched->lat, DRM_SCHED_LAT_DEP,
+			      entity->lat_dep_start, now);
+#endif
 
 	entity->dependency = NULL;
 	dma_fence_put(f);
+
+	/* Ready again, back into the vruntime tree. */
+	drm_sched_rq_update_entity(entity->rq, entity);
 }
 
 /*
@@ -417,6 +462,9 @@ static bool drm_sched_entity_add_dependency_cb(struct drm_sched_entity *entity)
 		fence = dma_fence_get(&s_fence->scheduled);
 		dma_fence_put(entity->dependency);
 		entity->dependency = fence;
+#ifdef __FreeBSD__
+		entity->lat_dep_start = ktime_get();
+#endif
 		if (!dma_fence_add_callback(fence, &entity->cb,
 					    drm_sched_entity_clear_dep))
 			return true;
@@ -426,6 +474,9 @@ static bool drm_sched_entity_add_dependency_cb(struct drm_sched_entity *entity)
 		return false;
 	}
 
+#ifdef __FreeBSD__
+	entity->lat_dep_start = ktime_get();
+#endif
 	if (!dma_fence_add_callback(entity->dependency, &entity->cb,
 				    drm_sched_entity_wakeup))
 		return true;
@@ -446,8 +497,11 @@ struct drm_sched_job *drm_sched_entity_pop_job(struct drm_sched_entity *entity)
 			drm_sched_job_dependency(sched_job, entity))) {
 		trace_drm_sched_job_wait_dep(sched_job, entity->dependency);
 
-		if (drm_sched_entity_add_dependency_cb(entity))
+		if (drm_sched_entity_add_dependency_cb(entity)) {
+			/* Out of the vruntime tree until clear_dep(). */
+			drm_sched_rq_update_entity(entity->rq, entity);
 			return NULL;
+		}
 	}
 
 	/* skip jobs from entity that marked guilty */
@@ -466,6 +520,7 @@ struct drm_sched_job *drm_sched_entity_pop_job(struct drm_sched_entity *entity)
 	smp_wmb();
 
 	spsc_queue_pop(&entity->job_queue);
+	drm_sched_rq_update_entity(entity->rq, entity);
 	return sched_job;
 }
 
@@ -502,6 +557,18 @@ void drm_sched_entity_select_rq(struct drm_sched_entity *entity)
 	rq = sched ? &sched->sched_rq[entity->priority] : NULL;
 	if (rq != entity->rq) {
 		drm_sched_rq_remove_entity(entity->rq, entity);
+		/*
+		 * vruntime only means something relative to the min_vruntime
+		 * of its run queue, carry the lag over instead of the value.
+		 */
+		if (rq) {
+			u64 old_min = entity->rq ?
+				READ_ONCE(entity->rq->min_vruntime) : U64_MAX;
+			u64 lag = entity->vruntime > old_min ?
+				entity->vruntime - old_min : 0;
+
+			entity->vruntime = READ_ONCE(rq->min_vruntime) + lag;
+		}
 		entity->rq = rq;
 	}
 	spin_unlock(&entity->rq_lock);
@@ -529,6 +596,16 @@ void drm_sched_entity_push_job(struct drm_sched_job *sched_job)
 	trace_drm_sched_job(sched_job, entity);
 	atomic_inc(entity->rq->sched->score);
 	WRITE_ONCE(entity->last_user, current->group_leader);
+	if (entity->stats) {
+		sched_job->entity_stats = entity->stats;
+		kref_get(&entity->stats->refcount);
+	}
+#ifdef __FreeBSD__
+	/* Set up before the scheduler thread can see the job. */
+	sched_job->lat_submit = ktime_get();
+	sched_job->lat = entity->lat;
+	kref_get(&sched_job->lat->refcount);
+#endif
 	first = spsc_queue_push(&entity->job_queue, &sched_job->queue_node);
 
 	/* first job wakes up scheduler */
@@ -542,6 +619,7 @@ void drm_sched_entity_push_job(struct drm_sched_job *sched_job)
 			return;
 		}
 		drm_sched_rq_add_entity(entity->rq, entity);
+		drm_sched_rq_update_entity(entity->rq, entity);
 		spin_unlock(&entity->rq_lock);
 		drm_sched_wakeup(entity->rq->sched);
 	}
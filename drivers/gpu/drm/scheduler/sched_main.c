@@ -27,7 +27,8 @@
  * The GPU scheduler provides entities which allow userspace to push jobs
  * into software queues which are then scheduled on a hardware run queue.
  * The software queues have a priority among them. The scheduler selects the entities
- * from the run queue using a FIFO. The scheduler provides dependency handling
+ * from the run queue using a FIFO, or by least GPU time used with
+ * &DRM_SCHED_POLICY_VRUNTIME. The scheduler provides dependency handling
  * features among jobs. The driver is supposed to provide callback functions for
  * backend operations to the scheduler like submitting a job to hardware run queue,
  * returning the dependencies of a job etc.
@@ -59,9 +60,159 @@
 #define CREATE_TRACE_POINTS
 #include "gpu_scheduler_trace.h"
 
+#ifdef __FreeBSD__
+SDT_PROBE_DEFINE7(drm, sched, , sched_job, "struct drm_sched_job *",
+    "struct drm_sched_entity *", "struct dma_fence *", "char *", "uint64_t",
+    "uint32_t", "int");
+SDT_PROBE_DEFINE7(drm, sched, , run_job, "struct drm_sched_job *",
+    "struct drm_sched_entity *", "struct dma_fence *", "char *", "uint64_t",
+    "uint32_t", "int");
+SDT_PROBE_DEFINE2(drm, sched, , process_job, "struct drm_sched_fence *",
+    "struct dma_fence *");
+SDT_PROBE_DEFINE6(drm, sched, , job_wait_dep, "struct drm_sched_job *",
+    "char *", "uint64_t", "struct dma_fence *", "uint64_t", "uint64_t");
+
+/* Schedulers and entities whose histograms drm_sched_lat_print() shows. */
+static LIST_HEAD(drm_sched_lat_list);
+static DEFINE_MUTEX(drm_sched_lat_lock);
+
+static const char *drm_sched_lat_names[DRM_SCHED_LAT_COUNT] = {
+	[DRM_SCHED_LAT_QUEUE] = "queue",
+	[DRM_SCHED_LAT_HW] = "hw",
+	[DRM_SCHED_LAT_DEP] = "dep",
+};
+
+void drm_sched_lat_init(struct drm_sched_lat *lat, struct device *dev,
+			const char *name, bool entity)
+{
+	kref_init(&lat->refcount);
+	lat->dev = dev;
+	lat->name = name;
+	lat->entity = entity;
+	lat->pid = curproc->p_pid;
+	strlcpy(lat->comm, curproc->p_comm, sizeof(lat->comm));
+	memset(lat->hist, 0, sizeof(lat->hist));
+
+	mutex_lock(&drm_sched_lat_lock);
+	list_add_tail(&lat->link, &drm_sched_lat_list);
+	mutex_unlock(&drm_sched_lat_lock);
+}
+
+void drm_sched_lat_fini(struct drm_sched_lat *lat)
+{
+	/* drm_sched_fini() of a scheduler that was never initialized */
+	if (lat->link.next == NULL)
+		return;
+
+	mutex_lock(&drm_sched_lat_lock);
+	list_del_init(&lat->link);
+	mutex_unlock(&drm_sched_lat_lock);
+}
+
+static void drm_sched_lat_release(struct kref *kref)
+{
+	kfree(container_of(kref, struct drm_sched_lat, refcount));
+}
+
+void drm_sched_lat_put(struct drm_sched_lat *lat)
+{
+	kref_put(&lat->refcount, drm_sched_lat_release);
+}
+
+void drm_sched_lat_account(struct drm_sched_lat *lat,
+			   enum drm_sched_lat_type type, ktime_t start,
+			   ktime_t end)
+{
+	s64 us = ktime_us_delta(end, start);
+	int bucket;
+
+	bucket = us <= 0 ? 0 : min(fls64(us), DRM_SCHED_LAT_BUCKETS - 1);
+	atomic_add_long(&lat->hist[type][bucket], 1);
+}
+
+static void drm_sched_lat_print_one(struct drm_printer *p,
+				    struct drm_sched_lat *lat)
+{
+	u_long n;
+	int type, b;
+
+	for (type = 0; type < DRM_SCHED_LAT_COUNT; type++) {
+		drm_printf(p, "  %-5s", drm_sched_lat_names[type]);
+		for (b = 0; b < DRM_SCHED_LAT_BUCKETS; b++) {
+			n = READ_ONCE(lat->hist[type][b]);
+			if (n == 0)
+				continue;
+			if (b < DRM_SCHED_LAT_BUCKETS - 1)
+				drm_printf(p, " <%luus:%lu", 1UL << b, n);
+			else
+				drm_printf(p, " >=%luus:%lu", 1UL << (b - 1), n);
+		}
+		drm_printf(p, "\n");
+	}
+}
+
+/**
+ * drm_sched_lat_print - print the latency histograms of a device
+ *
+ * @p: printer to print to
+ * @dev: device the schedulers were created for
+ *
+ * Prints the histograms of every scheduler of @dev followed by those of the
+ * entities created on them.
+ */
+void drm_sched_lat_print(struct drm_printer *p, struct device *dev)
+{
+	struct drm_sched_lat *lat;
+
+	mutex_lock(&drm_sched_lat_lock);
+	list_for_each_entry(lat, &drm_sched_lat_list, link) {
+		if (lat->dev != dev || lat->entity)
+			continue;
+		drm_printf(p, "scheduler %s\n", lat->name);
+		drm_sched_lat_print_one(p, lat);
+	}
+	list_for_each_entry(lat, &drm_sched_lat_list, link) {
+		if (lat->dev != dev || !lat->entity)
+			continue;
+		drm_printf(p, "entity %p pid %d (%s) on %s\n", lat,
+			   lat->pid, lat->comm, lat->name ? lat->name : "-");
+		drm_sched_lat_print_one(p, lat);
+	}
+	mutex_unlock(&drm_sched_lat_lock);
+}
+EXPORT_SYMBOL(drm_sched_lat_print);
+#endif
+
 #define to_drm_sched_job(sched_job)		\
 		container_of((sched_job), struct drm_sched_job, queue_node)
 
+static int drm_sched_policy = DRM_SCHED_POLICY_RR;
+
+MODULE_PARM_DESC(sched_policy, "Run queue policy for schedulers not choosing one (1 = round robin (default), 2 = virtual runtime)");
+module_param_named(sched_policy, drm_sched_policy, int, 0444);
+
+static unsigned int drm_sched_dispatch_batch = 1;
+
+MODULE_PARM_DESC(sched_dispatch_batch, "Jobs a scheduler may hand to the hardware per wakeup (default 1)");
+module_param_named(sched_dispatch_batch, drm_sched_dispatch_batch, uint, 0444);
+
+/*
+ * Takes the lock of a run queue, counting on FreeBSD how often it is taken
+ * and how often that had to wait, see &drm_sched_rq.lock_contended.
+ */
+static inline void drm_sched_rq_lock(struct drm_sched_rq *rq)
+{
+#ifdef __FreeBSD__
+	if (!spin_trylock(&rq->lock)) {
+		spin_lock(&rq->lock);
+		rq->lock_contended++;
+	}
+	rq->lock_count++;
+#else
+	spin_lock(&rq->lock);
+#endif
+}
+
 /**
  * drm_sched_rq_init - initialize a given run queue struct
  *
@@ -76,6 +227,12 @@ static void drm_sched_rq_init(struct drm_gpu_scheduler *sched,
 	spin_lock_init(&rq->lock);
 	INIT_LIST_HEAD(&rq->entities);
 	rq->current_entity = NULL;
+	rq->rb_root = RB_ROOT_CACHED;
+	rq->min_vruntime = 0;
+#ifdef __FreeBSD__
+	rq->lock_count = 0;
+	rq->lock_contended = 0;
+#endif
 	rq->sched = sched;
 }
 
@@ -92,7 +249,7 @@ void drm_sched_rq_add_entity(struct drm_sched_rq *rq,
 {
 	if (!list_empty(&entity->list))
 		return;
-	spin_lock(&rq->lock);
+	drm_sched_rq_lock(rq);
 	atomic_inc(rq->sched->score);
 	list_add_tail(&entity->list, &rq->entities);
 	spin_unlock(&rq->lock);
@@ -111,14 +268,117 @@ void drm_sched_rq_remove_entity(struct drm_sched_rq *rq,
 {
 	if (list_empty(&entity->list))
 		return;
-	spin_lock(&rq->lock);
+	drm_sched_rq_lock(rq);
 	atomic_dec(rq->sched->score);
 	list_del_init(&entity->list);
 	if (rq->current_entity == entity)
 		rq->current_entity = NULL;
+	if (!RB_EMPTY_NODE(&entity->rb_node)) {
+		rb_erase_cached(&entity->rb_node, &rq->rb_root);
+		RB_CLEAR_NODE(&entity->rb_node);
+	}
 	spin_unlock(&rq->lock);
 }
 
+/**
+ * drm_sched_rq_update_entity - requeue an entity by its virtual runtime
+ *
+ * @rq: scheduler run queue
+ * @entity: scheduler entity
+ *
+ * Charges @entity the GPU time its jobs used since the last update and
+ * moves it to its new place in the rbtree of @rq, or takes it out when it
+ * has no queued jobs left or is blocked on a dependency.  Called when a
+ * job is pushed to an empty entity, whenever the scheduler pops a job off
+ * it or finds it blocked, and from the dependency callback.  Does nothing
+ * unless the scheduler of @rq uses &DRM_SCHED_POLICY_VRUNTIME.
+ */
+void drm_sched_rq_update_entity(struct drm_sched_rq *rq,
+				struct drm_sched_entity *entity)
+{
+	struct rb_node **link, *parent = NULL;
+	bool leftmost = true;
+	u64 runtime;
+
+	if (rq->sched->policy != DRM_SCHED_POLICY_VRUNTIME)
+		return;
+
+	drm_sched_rq_lock(rq);
+	if (!RB_EMPTY_NODE(&entity->rb_node)) {
+		rb_erase_cached(&entity->rb_node, &rq->rb_root);
+		RB_CLEAR_NODE(&entity->rb_node);
+	}
+
+	/*
+	 * Checked under the lock, so a racing push or dependency callback
+	 * either sees the entity out of the tree or finds it ready here.
+	 */
+	if (list_empty(&entity->list) || !drm_sched_entity_is_ready(entity))
+		goto out;
+
+	if (entity->stats) {
+		runtime = atomic64_read(&entity->stats->runtime);
+		entity->vruntime += runtime - entity->runtime_seen;
+		entity->runtime_seen = runtime;
+	}
+	entity->vruntime = max(entity->vruntime, rq->min_vruntime);
+
+	link = &rq->rb_root.rb_root.rb_node;
+	while (*link) {
+		struct drm_sched_entity *e;
+
+		parent = *link;
+		e = rb_entry(parent, struct drm_sched_entity, rb_node);
+		if (entity->vruntime < e->vruntime) {
+			link = &parent->rb_left;
+		} else {
+			link = &parent->rb_right;
+			leftmost = false;
+		}
+	}
+	rb_link_node(&entity->rb_node, parent, link);
+	rb_insert_color_cached(&entity->rb_node, &rq->rb_root, leftmost);
+out:
+	spin_unlock(&rq->lock);
+}
+
+static void drm_sched_entity_stats_release(struct kref *kref)
+{
+	kfree(container_of(kref, struct drm_sched_entity_stats, refcount));
+}
+
+void drm_sched_entity_stats_put(struct drm_sched_entity_stats *stats)
+{
+	kref_put(&stats->refcount, drm_sched_entity_stats_release);
+}
+
+/**
+ * drm_sched_rq_select_entity_vruntime - Select the ready entity with the
+ * least virtual runtime
+ *
+ * @rq: scheduler run queue to check.
+ *
+ * Only ready entities are in the rbtree, so this is its leftmost one.
+ * Returns NULL if none is ready.
+ */
+static struct drm_sched_entity *
+drm_sched_rq_select_entity_vruntime(struct drm_sched_rq *rq)
+{
+	struct drm_sched_entity *entity = NULL;
+	struct rb_node *rb;
+
+	drm_sched_rq_lock(rq);
+	rb = rb_first_cached(&rq->rb_root);
+	if (rb) {
+		entity = rb_entry(rb, struct drm_sched_entity, rb_node);
+		rq->min_vruntime = max(rq->min_vruntime, entity->vruntime);
+		reinit_completion(&entity->entity_idle);
+	}
+	spin_unlock(&rq->lock);
+
+	return entity;
+}
+
 /**
  * drm_sched_rq_select_entity - Select an entity which could provide a job to run
  *
@@ -131,7 +391,10 @@ drm_sched_rq_select_entity(struct drm_sched_rq *rq)
 {
 	struct drm_sched_entity *entity;
 
-	spin_lock(&rq->lock);
+	if (rq->sched->policy == DRM_SCHED_POLICY_VRUNTIME)
+		return drm_sched_rq_select_entity_vruntime(rq);
+
+	drm_sched_rq_lock(rq);
 
 	entity = rq->current_entity;
 	if (entity) {
@@ -173,6 +436,33 @@ static void drm_sched_job_done(struct drm_sched_job *s_job)
 {
 	struct drm_sched_fence *s_fence = s_job->s_fence;
 	struct drm_gpu_scheduler *sched = s_fence->sched;
+	ktime_t now = ktime_get();
+#ifdef __FreeBSD__
+	struct drm_sched_lat *lat;
+
+	drm_sched_lat_account(&sched->lat, DRM_SCHED_LAT_HW, s_job->lat_run, now);
+	lat = xchg(&s_job->lat, NULL);
+	if (lat != NULL) {
+		drm_sched_lat_account(lat, DRM_SCHED_LAT_HW, s_job->lat_run, now);
+		drm_sched_lat_put(lat);
+	}
+#endif
+
+	/*
+	 * The hardware works through its queue in order, so a job only
+	 * occupies it from whichever is later of its own start and the
+	 * completion of the job before it.
+	 */
+	if (s_job->entity_stats) {
+		ktime_t start = READ_ONCE(sched->last_done);
+
+		if (ktime_after(s_job->start_time, start))
+			start = s_job->start_time;
+
+		atomic64_add(ktime_to_ns(ktime_sub(now, start)),
+			     &s_job->entity_stats->runtime);
+	}
+	WRITE_ONCE(sched->last_done, now);
 
 	atomic_dec(&sched->hw_rq_count);
 	atomic_dec(sched->score);
@@ -566,6 +856,9 @@ void drm_sched_resubmit_jobs_ext(struct drm_gpu_scheduler *sched, int max)
 			dma_fence_put(fence);
 		}
 	}
+
+	if (i && sched->ops->flush_jobs)
+		sched->ops->flush_jobs(sched);
 }
 EXPORT_SYMBOL(drm_sched_resubmit_jobs_ext);
 
@@ -603,6 +896,10 @@ int drm_sched_job_init(struct drm_sched_job *job,
 	INIT_LIST_HEAD(&job->list);
 
 	xa_init_flags(&job->dependencies, XA_FLAGS_ALLOC);
+	job->entity_stats = NULL;
+#ifdef __FreeBSD__
+	job->lat = NULL;
+#endif
 
 	return 0;
 }
@@ -741,6 +1038,19 @@ void drm_sched_job_cleanup(struct drm_sched_job *job)
 {
 	struct dma_fence *fence;
 	unsigned long index;
+#ifdef __FreeBSD__
+	struct drm_sched_lat *lat;
+
+	/* Jobs that never completed on the hardware still hold a reference. */
+	lat = xchg(&job->lat, NULL);
+	if (lat != NULL)
+		drm_sched_lat_put(lat);
+#endif
+
+	if (job->entity_stats) {
+		drm_sched_entity_stats_put(job->entity_stats);
+		job->entity_stats = NULL;
+	}
 
 	if (kref_read(&job->s_fence->finished.refcount)) {
 		/* drm_sched_job_arm() has been called */
@@ -907,26 +1217,83 @@ static bool drm_sched_blocked(struct drm_gpu_scheduler *sched)
 	return false;
 }
 
+/**
+ * drm_sched_run_job - hand a job to the hardware
+ *
+ * @sched: scheduler instance
+ * @entity: entity the job was popped from
+ * @sched_job: the job
+ */
+static void drm_sched_run_job(struct drm_gpu_scheduler *sched,
+			      struct drm_sched_entity *entity,
+			      struct drm_sched_job *sched_job)
+{
+	struct drm_sched_fence *s_fence = sched_job->s_fence;
+	struct dma_fence *fence;
+	int r;
+
+	/* One clock read per job, shared by the runtime and latency stats. */
+	sched_job->start_time = ktime_get();
+#ifdef __FreeBSD__
+	sched_job->lat_run = sched_job->start_time;
+	drm_sched_lat_account(&sched->lat, DRM_SCHED_LAT_QUEUE,
+			      sched_job->lat_submit, sched_job->lat_run);
+	if (sched_job->lat != NULL)
+		drm_sched_lat_account(sched_job->lat,
+				      DRM_SCHED_LAT_QUEUE,
+				      sched_job->lat_submit,
+				      sched_job->lat_run);
+#endif
+	atomic_inc(&sched->hw_rq_count);
+	drm_sched_job_begin(sched_job);
+
+	trace_drm_run_job(sched_job, entity);
+	fence = sched->ops->run_job(sched_job);
+	complete(&entity->entity_idle);
+	drm_sched_fence_scheduled(s_fence);
+
+	if (!IS_ERR_OR_NULL(fence)) {
+		s_fence->parent = dma_fence_get(fence);
+		/* Drop for original kref_init of the fence */
+		dma_fence_put(fence);
+
+		r = dma_fence_add_callback(fence, &sched_job->cb,
+					   drm_sched_job_done_cb);
+		if (r == -ENOENT)
+			drm_sched_job_done(sched_job);
+		else if (r)
+			DRM_DEV_ERROR(sched->dev, "fence add callback failed (%d)\n",
+				  r);
+	} else {
+		if (IS_ERR(fence))
+			dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
+
+		drm_sched_job_done(sched_job);
+	}
+}
+
 /**
  * drm_sched_main - main scheduler thread
  *
  * @param: scheduler instance
  *
+ * Each wakeup picks up to &drm_gpu_scheduler.dispatch_batch entities, one
+ * job from each, for as long as the hardware queue has room, and then
+ * calls &drm_sched_backend_ops.flush_jobs once for all of them.
+ *
  * Returns 0.
  */
 static int drm_sched_main(void *param)
 {
 	struct drm_gpu_scheduler *sched = (struct drm_gpu_scheduler *)param;
-	int r;
 
 	sched_set_fifo_low(current);
 
 	while (!kthread_should_stop()) {
 		struct drm_sched_entity *entity = NULL;
-		struct drm_sched_fence *s_fence;
 		struct drm_sched_job *sched_job;
-		struct dma_fence *fence;
 		struct drm_sched_job *cleanup_job = NULL;
+		unsigned int i, batch, count;
 
 		wait_event_interruptible(sched->wake_up_worker,
 					 (cleanup_job = drm_sched_get_cleanup_job(sched)) ||
@@ -940,41 +1307,33 @@ static int drm_sched_main(void *param)
 		if (!entity)
 			continue;
 
-		sched_job = drm_sched_entity_pop_job(entity);
-
-		if (!sched_job) {
-			complete(&entity->entity_idle);
-			continue;
-		}
-
-		s_fence = sched_job->s_fence;
-
-		atomic_inc(&sched->hw_rq_count);
-		drm_sched_job_begin(sched_job);
+		batch = max(READ_ONCE(sched->dispatch_batch), 1u);
+		count = 0;
+		for (i = 0; i < batch; i++) {
+			if (i > 0) {
+				if (kthread_should_stop() || kthread_should_park())
+					break;
+				/* Also stops once the hardware queue is full. */
+				entity = drm_sched_select_entity(sched);
+				if (!entity)
+					break;
+			}
 
-		trace_drm_run_job(sched_job, entity);
-		fence = sched->ops->run_job(sched_job);
-		complete(&entity->entity_idle);
-		drm_sched_fence_scheduled(s_fence);
+			sched_job = drm_sched_entity_pop_job(entity);
+			if (!sched_job) {
+				complete(&entity->entity_idle);
+				continue;
+			}
 
-		if (!IS_ERR_OR_NULL(fence)) {
-			s_fence->parent = dma_fence_get(fence);
-			/* Drop for original kref_init of the fence */
-			dma_fence_put(fence);
+			drm_sched_run_job(sched, entity, sched_job);
+			count++;
+		}
 
-			r = dma_fence_add_callback(fence, &sched_job->cb,
-						   drm_sched_job_done_cb);
-			if (r == -ENOENT)
-				drm_sched_job_done(sched_job);
-			else if (r)
-				DRM_DEV_ERROR(sched->dev, "fence add callback failed (%d)\n",
-					  r);
-		} else {
-			if (IS_ERR(fence))
-				dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
+		if (!count)
+			continue;
 
-			drm_sched_job_done(sched_job);
-		}
+		if (sched->ops->flush_jobs)
+			sched->ops->flush_jobs(sched);
 
 		wake_up(&sched->job_scheduled);
 	}
@@ -994,6 +1353,8 @@ static int drm_sched_main(void *param)
  * @score: optional score atomic shared with other schedulers
  * @name: name used for debugging
  * @dev: target &struct device
+ * @policy: entity selection policy of the run queues, see
+ *	    &enum drm_sched_policy
  *
  * Return 0 on success, otherwise error code.
  */
@@ -1001,7 +1362,8 @@ int drm_sched_init(struct drm_gpu_scheduler *sched,
 		   const struct drm_sched_backend_ops *ops,
 		   unsigned hw_submission, unsigned hang_limit,
 		   long timeout, struct workqueue_struct *timeout_wq,
-		   atomic_t *score, const char *name, struct device *dev)
+		   atomic_t *score, const char *name, struct device *dev,
+		   enum drm_sched_policy policy)
 {
 	int i, ret;
 	sched->ops = ops;
@@ -1012,6 +1374,13 @@ int drm_sched_init(struct drm_gpu_scheduler *sched,
 	sched->hang_limit = hang_limit;
 	sched->score = score ? score : &sched->_score;
 	sched->dev = dev;
+	sched->policy = policy == DRM_SCHED_POLICY_DEFAULT ?
+		drm_sched_policy : policy;
+	if (sched->policy <= DRM_SCHED_POLICY_DEFAULT ||
+	    sched->policy >= DRM_SCHED_POLICY_COUNT)
+		sched->policy = DRM_SCHED_POLICY_RR;
+	sched->last_done = 0;
+	sched->dispatch_batch = max(drm_sched_dispatch_batch, 1u);
 	for (i = DRM_SCHED_PRIORITY_MIN; i < DRM_SCHED_PRIORITY_COUNT; i++)
 		drm_sched_rq_init(sched, &sched->sched_rq[i]);
 
@@ -1023,12 +1392,18 @@ int drm_sched_init(struct drm_gpu_scheduler *sched,
 	INIT_DELAYED_WORK(&sched->work_tdr, drm_sched_job_timedout);
 	atomic_set(&sched->_score, 0);
 	atomic64_set(&sched->job_id_count, 0);
+#ifdef __FreeBSD__
+	drm_sched_lat_init(&sched->lat, dev, name, false);
+#endif
 
 	/* Each scheduler will run on a seperate kernel thread */
 	sched->thread = kthread_run(drm_sched_main, sched, sched->name);
 	if (IS_ERR(sched->thread)) {
 		ret = PTR_ERR(sched->thread);
 		sched->thread = NULL;
+#ifdef __FreeBSD__
+		drm_sched_lat_fini(&sched->lat);
+#endif
 		DRM_DEV_ERROR(sched->dev, "Failed to create scheduler for %s.\n", name);
 		return ret;
 	}
@@ -1076,6 +1451,9 @@ void drm_sched_fini(struct drm_gpu_scheduler *sched)
 
 	/* Confirm no work left behind accessing device structures */
 	cancel_delayed_work_sync(&sched->work_tdr);
+#ifdef __FreeBSD__
+	drm_sched_lat_fini(&sched->lat);
+#endif
 
 	sched->ready = false;
 }
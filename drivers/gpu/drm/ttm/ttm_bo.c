@@ -44,6 +44,15 @@
 
 #include "ttm_module.h"
 
+#ifdef __FreeBSD__
+#include <sys/sdt.h>
+
+SDT_PROVIDER_DECLARE(drm);
+/* bo, size in bytes, old and new memory type, evict */
+SDT_PROBE_DEFINE5(drm, ttm, , bo_move, "struct ttm_buffer_object *",
+    "size_t", "int", "int", "bool");
+#endif
+
 static void ttm_bo_mem_space_debug(struct ttm_buffer_object *bo,
 					struct ttm_placement *placement)
 {
@@ -150,6 +159,11 @@ static int ttm_bo_handle_move_mem(struct ttm_buffer_object *bo,
 	if (ret)
 		goto out_err;
 
+#ifdef __FreeBSD__
+	SDT_PROBE5(drm, ttm, , bo_move, bo, bo->base.size,
+	    bo->resource ? (int)bo->resource->mem_type : -1,
+	    (int)mem->mem_type, evict);
+#endif
 	ret = bdev->funcs->move(bo, evict, ctx, mem, hop);
 	if (ret) {
 		if (ret == -EMULTIHOP)
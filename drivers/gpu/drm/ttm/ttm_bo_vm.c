@@ -42,6 +42,25 @@
 #include <linux/module.h>
 #include <linux/uaccess.h>
 #include <linux/mem_encrypt.h>
+#ifdef __FreeBSD__
+#include <sys/sysctl.h>
+
+#include <vm/vm.h>
+#include <vm/pmap.h>
+#include <vm/vm_object.h>
+#include <vm/vm_page.h>
+
+#include <drm/ttm/ttm_sysctl_freebsd.h>
+
+/*
+ * Upper bound of the prefault window, which grows from the number of pages
+ * asked for by the driver while a BO is faulted in sequentially.
+ */
+static unsigned int ttm_bo_vm_max_prefault = 512;
+SYSCTL_UINT(_hw_ttm, OID_AUTO, vm_max_prefault, CTLFLAG_RWTUN,
+    &ttm_bo_vm_max_prefault, 0,
+    "Maximum number of pages mapped by a BO CPU page fault");
+#endif
 
 static vm_fault_t ttm_bo_vm_fault_idle(struct ttm_buffer_object *bo,
 				struct vm_fault *vmf)
@@ -97,6 +116,117 @@ static unsigned long ttm_bo_io_mem_pfn(struct ttm_buffer_object *bo,
 	return (bo->resource->bus.offset >> PAGE_SHIFT) + page_offset;
 }
 
+#ifdef __FreeBSD__
+/* Return the pfn of page @page_offset of the BO, false if not populated */
+static bool ttm_bo_vm_pfn(struct ttm_buffer_object *bo, struct ttm_tt *ttm,
+			  unsigned long page_offset, unsigned long *pfn)
+{
+	struct page *page;
+
+	if (bo->resource->bus.is_iomem) {
+		*pfn = ttm_bo_io_mem_pfn(bo, page_offset);
+		return true;
+	}
+
+	page = ttm->pages[page_offset];
+	if (unlikely(!page))
+		return false;
+
+	page->oflags &= ~VPO_UNMANAGED;
+	*pfn = page_to_pfn(page);
+	return true;
+}
+
+/*
+ * Return the number of pages to prefault from @page_offset. The window
+ * starts at @num_prefault and doubles with each fault right behind the
+ * pages mapped by the previous one, so that streaming through a large BO
+ * takes few faults while random access doesn't map pages it won't touch.
+ */
+static pgoff_t ttm_bo_vm_prefault_window(struct ttm_buffer_object *bo,
+					 unsigned long page_offset,
+					 pgoff_t num_prefault)
+{
+	pgoff_t window = num_prefault;
+
+	if (num_prefault > 1 && bo->fault_window &&
+	    page_offset == bo->fault_next)
+		window = min_t(pgoff_t, bo->fault_window * 2,
+			       max_t(pgoff_t, ttm_bo_vm_max_prefault,
+				     num_prefault));
+	bo->fault_window = window;
+
+	return window;
+}
+
+/*
+ * Insert @count pages at consecutive pfns starting from @pfn at @address,
+ * as that many lkpi_vmf_insert_pfn_prot_locked() calls would. The pages
+ * already in the VM object are found with a single walk of its page list
+ * and the memory attribute is only set on pages which don't have it yet.
+ * Pages that are busy or owned by another object are left to the LinuxKPI
+ * helper. Returns the number of pages inserted in @inserted.
+ */
+static vm_fault_t
+ttm_bo_vm_insert_pfn_range_locked(struct vm_area_struct *vma,
+				  unsigned long address, unsigned long pfn,
+				  unsigned long count, pgprot_t prot,
+				  unsigned long *inserted)
+{
+	vm_object_t obj = vma->vm_obj;
+	vm_memattr_t memattr = pgprot2cachemode(prot);
+	vm_pindex_t pindex = OFF_TO_IDX(address - vma->vm_start);
+	vm_fault_t ret = VM_FAULT_NOPAGE;
+	vm_page_t m, page;
+	unsigned long i;
+
+	VM_OBJECT_ASSERT_WLOCKED(obj);
+
+	m = vm_page_find_least(obj, pindex);
+	for (i = 0; i < count; ++i, ++pindex) {
+		while (m && m->pindex < pindex)
+			m = TAILQ_NEXT(m, listq);
+		if (m && m->pindex == pindex)
+			page = m;
+		else
+			page = PHYS_TO_VM_PAGE(IDX_TO_OFF(pfn + i));
+
+		if (!vm_page_tryxbusy(page)) {
+			page = NULL;
+		} else if (page != m && page->object) {
+			vm_page_xunbusy(page);
+			page = NULL;
+		}
+		if (!page) {
+			ret = lkpi_vmf_insert_pfn_prot_locked(vma,
+				address + (i << PAGE_SHIFT), pfn + i, prot);
+			if (unlikely(ret & VM_FAULT_ERROR))
+				break;
+			/* The object may have been unlocked meanwhile */
+			m = vm_page_find_least(obj, pindex + 1);
+			continue;
+		}
+
+		if (page != m) {
+			if (vm_page_insert(page, obj, pindex)) {
+				vm_page_xunbusy(page);
+				ret = VM_FAULT_OOM;
+				break;
+			}
+			vm_page_valid(page);
+		}
+		if (pmap_page_get_memattr(page) != memattr)
+			pmap_page_set_memattr(page, memattr);
+		if (vma->vm_pfn_count == 0)
+			vma->vm_pfn_first = pindex;
+		vma->vm_pfn_count++;
+	}
+
+	*inserted = i;
+	return ret;
+}
+#endif
+
 /**
  * ttm_bo_vm_reserve - Reserve a buffer object in a retryable vm callback
  * @bo: The buffer object
@@ -194,7 +324,11 @@ vm_fault_t ttm_bo_vm_fault_reserved(struct vm_fault *vmf,
 	unsigned long page_last;
 	unsigned long pfn;
 	struct ttm_tt *ttm = NULL;
+#ifdef __linux__
 	struct page *page;
+#elif defined(__FreeBSD__)
+	unsigned long count, inserted, next;
+#endif
 	int err;
 	pgoff_t i;
 	vm_fault_t ret = VM_FAULT_NOPAGE;
@@ -240,29 +374,20 @@ vm_fault_t ttm_bo_vm_fault_reserved(struct vm_fault *vmf,
 	 * Speculatively prefault a number of pages. Only error on
 	 * first page.
 	 */
-#ifdef __FreeBSD__
-	VM_OBJECT_WLOCK(vma->vm_obj);
-#endif
+#ifdef __linux__
 	for (i = 0; i < num_prefault; ++i) {
 		if (bo->resource->bus.is_iomem) {
 			pfn = ttm_bo_io_mem_pfn(bo, page_offset);
 		} else {
 			page = ttm->pages[page_offset];
 			if (unlikely(!page && i == 0)) {
-#ifdef __FreeBSD__
-				VM_OBJECT_WUNLOCK(vma->vm_obj);
-#endif
 				return VM_FAULT_OOM;
 			} else if (unlikely(!page)) {
 				break;
 			}
-#ifdef __FreeBSD__
-			page->oflags &= ~VPO_UNMANAGED;
-#endif
 			pfn = page_to_pfn(page);
 		}
 
-#ifdef __linux__
 		/*
 		 * Note that the value of @prot at this point may differ from
 		 * the value of @vma->vm_page_prot in the caching- and
@@ -272,18 +397,12 @@ vm_fault_t ttm_bo_vm_fault_reserved(struct vm_fault *vmf,
 		 * See vmf_insert_mixed_prot() for a discussion.
 		 */
 		ret = vmf_insert_pfn_prot(vma, address, pfn, prot);
-#elif defined(__FreeBSD__)
-		ret = lkpi_vmf_insert_pfn_prot_locked(vma, address, pfn, prot);
-#endif
 
 		/* Never error on prefaulted PTEs */
 		if (unlikely((ret & VM_FAULT_ERROR))) {
-			if (i == 0) {
-#ifdef __FreeBSD__
-				VM_OBJECT_WUNLOCK(vma->vm_obj);
-#endif
+			if (i == 0)
 				return VM_FAULT_NOPAGE;
-			} else
+			else
 				break;
 		}
 
@@ -291,8 +410,44 @@ vm_fault_t ttm_bo_vm_fault_reserved(struct vm_fault *vmf,
 		if (unlikely(++page_offset >= page_last))
 			break;
 	}
-#ifdef __FreeBSD__
+#elif defined(__FreeBSD__)
+	/*
+	 * The pages are inserted a run of consecutive pfns at a time, which
+	 * for system memory is usually a whole chunk of the ttm_tt.
+	 */
+	num_prefault = ttm_bo_vm_prefault_window(bo, page_offset, num_prefault);
+	VM_OBJECT_WLOCK(vma->vm_obj);
+	for (i = 0; i < num_prefault; i += count) {
+		if (unlikely(!ttm_bo_vm_pfn(bo, ttm, page_offset, &pfn))) {
+			if (i == 0)
+				ret = VM_FAULT_OOM;
+			break;
+		}
+		for (count = 1; i + count < num_prefault &&
+		     page_offset + count < page_last; ++count) {
+			if (!ttm_bo_vm_pfn(bo, ttm, page_offset + count,
+					   &next) ||
+			    next != pfn + count)
+				break;
+		}
+
+		ret = ttm_bo_vm_insert_pfn_range_locked(vma, address, pfn,
+							count, prot, &inserted);
+		page_offset += inserted;
+
+		/* Never error on prefaulted PTEs */
+		if (unlikely((ret & VM_FAULT_ERROR))) {
+			if (i + inserted == 0)
+				ret = VM_FAULT_NOPAGE;
+			break;
+		}
+
+		address += count << PAGE_SHIFT;
+		if (unlikely(page_offset >= page_last))
+			break;
+	}
 	VM_OBJECT_WUNLOCK(vma->vm_obj);
+	bo->fault_next = page_offset;
 #endif
 	return ret;
 }
@@ -326,18 +481,20 @@ vm_fault_t ttm_bo_vm_dummy_page(struct vm_fault *vmf, pgprot_t prot)
 
 	pfn = page_to_pfn(page);
 
+#ifdef __linux__
 	/* Prefault the entire VMA range right away to avoid further faults */
-#ifdef __FreeBSD__
-	VM_OBJECT_WLOCK(vma->vm_obj);
-#endif
 	for (address = vma->vm_start; address < vma->vm_end;
 	     address += PAGE_SIZE)
-#ifdef __linux__
 		ret = vmf_insert_pfn_prot(vma, address, pfn, prot);
 #elif defined(__FreeBSD__)
-		ret = lkpi_vmf_insert_pfn_prot_locked(vma, address, pfn, prot);
-#endif
-#ifdef __FreeBSD__
+	/*
+	 * A vm_page can only be at one index of the VM object, so inserting
+	 * it over the entire VMA would just move it from index to index.
+	 * Map the faulting address only.
+	 */
+	address = vmf->address;
+	VM_OBJECT_WLOCK(vma->vm_obj);
+	ret = lkpi_vmf_insert_pfn_prot_locked(vma, address, pfn, prot);
 	VM_OBJECT_WUNLOCK(vma->vm_obj);
 #endif
 
@@ -44,6 +44,14 @@
 #include <drm/ttm/ttm_bo_driver.h>
 #include <drm/ttm/ttm_tt.h>
 #ifdef __FreeBSD__
+#include <sys/cpuset.h>
+#include <sys/sbuf.h>
+#include <sys/sysctl.h>
+#include <sys/taskqueue.h>
+
+#include <vm/vm_pagequeue.h>
+#include <vm/vm_phys.h>
+
 #include <drm/ttm/ttm_sysctl_freebsd.h>
 #endif
 
@@ -54,6 +62,9 @@
  *
  * @addr: original DMA address returned for the mapping
  * @vaddr: original vaddr return for the mapping and order in the lower bits
+ *
+ * On FreeBSD there is no page->private to hang this off, so the pool keeps
+ * them in its @dma_pages xarray, indexed by the pfn of the first page.
  */
 struct ttm_pool_dma {
 	dma_addr_t addr;
@@ -77,6 +88,88 @@ static spinlock_t shrinker_lock;
 static struct list_head shrinker_list;
 static struct shrinker mm_shrinker;
 
+#ifdef __FreeBSD__
+/*
+ * Pages given back to a pool are zeroed by a worker thread bound to the
+ * memory domain of the page instead of by the thread freeing the BO.  Until
+ * then they sit on the dirty lists of their pool type and are only zeroed
+ * synchronously if an allocation finds no clean pages.
+ */
+static int ttm_pool_async_clear = 1;
+SYSCTL_INT(_hw_ttm, OID_AUTO, pool_async_clear, CTLFLAG_RWTUN,
+    &ttm_pool_async_clear, 0,
+    "Zero pages given back to the page pool asynchronously");
+
+static atomic_long_t dirty_pages;
+static struct taskqueue *clear_tq[MAXMEMDOM];
+static struct task clear_task[MAXMEMDOM];
+
+/*
+ * The pools keep their pages on per memory domain lists and allocations take
+ * the ones local to the device first.  The shrinker releases the share of
+ * each domain's pages that matches the shortage the domain is in.
+ */
+static atomic_long_t domain_pages[MAXMEMDOM];
+static atomic_long_t shrink_target[MAXMEMDOM];
+
+static int ttm_pool_sysctl_domain_pages(SYSCTL_HANDLER_ARGS)
+{
+	struct sbuf sb;
+	int error, i;
+
+	sbuf_new_for_sysctl(&sb, NULL, 64, req);
+	for (i = 0; i < vm_ndomains; ++i)
+		sbuf_printf(&sb, "%s%d:%ld", i ? " " : "", i,
+			    atomic_long_read(&domain_pages[i]));
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+
+	return error;
+}
+SYSCTL_PROC(_hw_ttm, OID_AUTO, pool_domain_pages,
+    CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE, NULL, 0,
+    ttm_pool_sysctl_domain_pages, "A",
+    "Pages held by the page pool per memory domain");
+
+/* Account pages entering (positive) or leaving the pools */
+static void ttm_pool_account(int domain, long num_pages, bool dirty)
+{
+	atomic_long_add(num_pages, &allocated_pages);
+	atomic_long_add(num_pages, &domain_pages[domain]);
+	if (dirty)
+		atomic_long_add(num_pages, &dirty_pages);
+}
+
+/* Zero pages of size 1 << order, bypassing the CPU caches where possible */
+static void ttm_pool_clear_page(struct page *p, unsigned int order)
+{
+	unsigned int i;
+
+	for (i = 0; i < 1 << order; ++i) {
+#ifdef __amd64__
+		u64 *va = (u64 *)PHYS_TO_DMAP(VM_PAGE_TO_PHYS(p + i));
+		unsigned int j;
+
+		for (j = 0; j < PAGE_SIZE / sizeof(*va); j += 4) {
+			__asm __volatile(
+			    "movnti %4, %0\n\t"
+			    "movnti %4, %1\n\t"
+			    "movnti %4, %2\n\t"
+			    "movnti %4, %3"
+			    : "=m" (va[j]), "=m" (va[j + 1]),
+			      "=m" (va[j + 2]), "=m" (va[j + 3])
+			    : "r" (0UL));
+		}
+#else
+		pmap_zero_page(p + i);
+#endif
+	}
+#ifdef __amd64__
+	__asm __volatile("sfence" ::: "memory");
+#endif
+}
+#endif
+
 /* Allocate pages of size 1 << order with the given gfp_flags */
 static struct page *ttm_pool_alloc_page(struct ttm_pool *pool, gfp_t gfp_flags,
 					unsigned int order)
@@ -128,8 +221,26 @@ static struct page *ttm_pool_alloc_page(struct ttm_pool *pool, gfp_t gfp_flags,
 	p->private = (unsigned long)dma;
 	return p;
 #elif defined(__FreeBSD__)
-	dma = NULL;
-	panic("ttm_pool.c: use_dma_alloc not implemented");
+	(void)attr;
+
+	dma = kmalloc(sizeof(*dma), GFP_KERNEL);
+	if (!dma)
+		return NULL;
+
+	vaddr = dma_alloc_coherent(pool->dev, (1ULL << order) * PAGE_SIZE,
+				   &dma->addr, gfp_flags);
+	if (!vaddr)
+		goto error_free;
+
+	p = virt_to_page(vaddr);
+	dma->vaddr = (unsigned long)vaddr | order;
+	if (xa_err(xa_store(&pool->dma_pages, page_to_pfn(p), dma,
+			    GFP_KERNEL))) {
+		dma_free_coherent(pool->dev, (1ULL << order) * PAGE_SIZE,
+				  vaddr, dma->addr);
+		goto error_free;
+	}
+	return p;
 #endif
 
 error_free:
@@ -167,6 +278,12 @@ static void ttm_pool_free_page(struct ttm_pool *pool, enum ttm_caching caching,
 	dma_free_attrs(pool->dev, (1UL << order) * PAGE_SIZE, vaddr, dma->addr,
 		       attr);
 	kfree(dma);
+#elif defined(__FreeBSD__)
+	dma = xa_erase(&pool->dma_pages, page_to_pfn(p));
+	vaddr = (void *)(dma->vaddr & PAGE_MASK);
+	dma_free_coherent(pool->dev, (1UL << order) * PAGE_SIZE, vaddr,
+			  dma->addr);
+	kfree(dma);
 #endif
 }
 
@@ -203,7 +320,8 @@ static int ttm_pool_map(struct ttm_pool *pool, unsigned int order,
 #ifdef __linux__
 		struct ttm_pool_dma *dma = (void *)p->private;
 #elif defined(__FreeBSD__)
-		struct ttm_pool_dma *dma = NULL;
+		struct ttm_pool_dma *dma = xa_load(&pool->dma_pages,
+						   page_to_pfn(p));
 #endif
 
 		addr = dma->addr;
@@ -238,57 +356,167 @@ static void ttm_pool_unmap(struct ttm_pool *pool, dma_addr_t dma_addr,
 /* Give pages into a specific pool_type */
 static void ttm_pool_type_give(struct ttm_pool_type *pt, struct page *p)
 {
+#ifdef __linux__
 	unsigned int i, num_pages = 1 << pt->order;
 
 	for (i = 0; i < num_pages; ++i) {
-#ifdef __linux__
 		if (PageHighMem(p))
 			clear_highpage(p + i);
 		else
 			clear_page(page_address(p + i));
+	}
 #elif defined(__FreeBSD__)
-		pmap_zero_page(p + i);
+	int domain = vm_page_domain(p);
+	bool async = ttm_pool_async_clear && clear_tq[domain];
+
+	if (!async)
+		ttm_pool_clear_page(p, pt->order);
 #endif
-	}
 
 	spin_lock(&pt->lock);
 #ifdef __linux__
 	list_add(&p->lru, &pt->pages);
 #elif defined(__FreeBSD__)
-	TAILQ_INSERT_HEAD(&pt->pages, p, plinks.q);
+	if (async)
+		TAILQ_INSERT_HEAD(&pt->dirty[domain], p, plinks.q);
+	else
+		TAILQ_INSERT_HEAD(&pt->pages[domain], p, plinks.q);
 #endif
 	spin_unlock(&pt->lock);
+#ifdef __linux__
 	atomic_long_add(1 << pt->order, &allocated_pages);
+#elif defined(__FreeBSD__)
+	ttm_pool_account(domain, 1L << pt->order, async);
+	if (async)
+		taskqueue_enqueue(clear_tq[domain], &clear_task[domain]);
+#endif
 }
 
+#ifdef __linux__
 /* Take pages from a specific pool_type, return NULL when nothing available */
 static struct page *ttm_pool_type_take(struct ttm_pool_type *pt)
 {
 	struct page *p;
 
 	spin_lock(&pt->lock);
-#ifdef __linux__
 	p = list_first_entry_or_null(&pt->pages, typeof(*p), lru);
-#elif defined(__FreeBSD__)
-	p = TAILQ_FIRST(&pt->pages);
-#endif
 	if (p) {
 		atomic_long_sub(1 << pt->order, &allocated_pages);
-#ifdef __linux__
 		list_del(&p->lru);
+	}
+	spin_unlock(&pt->lock);
+
+	return p;
+}
 #elif defined(__FreeBSD__)
-		TAILQ_REMOVE(&pt->pages, p, plinks.q);
-#endif
+/*
+ * Take pages from a specific pool_type, return NULL when nothing available.
+ * The @ndomains memory domains starting at @domain are tried in turn. With
+ * @clean, zeroed pages are preferred and a dirty one is zeroed before it is
+ * returned, otherwise dirty pages go first and stay dirty.
+ */
+static struct page *__ttm_pool_type_take(struct ttm_pool_type *pt, int domain,
+					 int ndomains, bool clean)
+{
+	struct pglist *list = NULL;
+	struct page *p = NULL;
+	int i, j, d;
+
+	spin_lock(&pt->lock);
+	for (i = 0; !p && i < ndomains; ++i) {
+		d = (domain + i) % vm_ndomains;
+		for (j = 0; !p && j < 2; ++j) {
+			list = (j == 0) == clean ? &pt->pages[d] :
+						   &pt->dirty[d];
+			p = TAILQ_FIRST(list);
+		}
 	}
+	if (p)
+		TAILQ_REMOVE(list, p, plinks.q);
 	spin_unlock(&pt->lock);
 
+	if (!p)
+		return NULL;
+
+	ttm_pool_account(d, -(1L << pt->order), list == &pt->dirty[d]);
+	if (clean && list == &pt->dirty[d])
+		ttm_pool_clear_page(p, pt->order);
+
 	return p;
 }
 
+/* Return the memory domain to allocate pages for @pool from */
+static int ttm_pool_domain(struct ttm_pool *pool)
+{
+	return pool->domain >= 0 ? pool->domain : PCPU_GET(domain);
+}
+
+/*
+ * Take zeroed pages from a specific pool_type, NULL when nothing available.
+ * Pages of the device local domain are preferred, even over clean ones from
+ * the other domains.
+ */
+static struct page *ttm_pool_type_take(struct ttm_pool_type *pt, int domain)
+{
+	return __ttm_pool_type_take(pt, domain, vm_ndomains, true);
+}
+
+/* Take pages from a specific pool_type to free them */
+static struct page *ttm_pool_type_reap(struct ttm_pool_type *pt)
+{
+	return __ttm_pool_type_take(pt, 0, vm_ndomains, false);
+}
+
+/* Zero the pages given back to the pools from one memory domain */
+static void ttm_pool_clear_work(void *arg, int pending __unused)
+{
+	int domain = (uintptr_t)arg;
+	struct ttm_pool_type *pt;
+	struct page *p;
+
+restart:
+	spin_lock(&shrinker_lock);
+	list_for_each_entry(pt, &shrinker_list, shrinker_list) {
+		spin_lock(&pt->lock);
+		p = TAILQ_FIRST(&pt->dirty[domain]);
+		if (p)
+			TAILQ_REMOVE(&pt->dirty[domain], p, plinks.q);
+		spin_unlock(&pt->lock);
+		if (!p)
+			continue;
+
+		/* ttm_pool_type_fini() drains us before the pt goes away */
+		spin_unlock(&shrinker_lock);
+		ttm_pool_clear_page(p, pt->order);
+
+		spin_lock(&pt->lock);
+		TAILQ_INSERT_HEAD(&pt->pages[domain], p, plinks.q);
+		spin_unlock(&pt->lock);
+		atomic_long_sub(1 << pt->order, &dirty_pages);
+		goto restart;
+	}
+	spin_unlock(&shrinker_lock);
+}
+
+/* Wait for the clearing workers to let go of any pool_type */
+static void ttm_pool_clear_drain(void)
+{
+	int i;
+
+	for (i = 0; i < vm_ndomains; ++i)
+		if (clear_tq[i])
+			taskqueue_drain(clear_tq[i], &clear_task[i]);
+}
+#endif
+
 /* Initialize and add a pool type to the global shrinker list */
 static void ttm_pool_type_init(struct ttm_pool_type *pt, struct ttm_pool *pool,
 			       enum ttm_caching caching, unsigned int order)
 {
+#ifdef __FreeBSD__
+	int i;
+
+#endif
 	pt->pool = pool;
 	pt->caching = caching;
 	pt->order = order;
@@ -296,7 +524,10 @@ static void ttm_pool_type_init(struct ttm_pool_type *pt, struct ttm_pool *pool,
 #ifdef __linux__
 	INIT_LIST_HEAD(&pt->pages);
 #elif defined(__FreeBSD__)
-	TAILQ_INIT(&pt->pages);
+	for (i = 0; i < MAXMEMDOM; ++i) {
+		TAILQ_INIT(&pt->pages[i]);
+		TAILQ_INIT(&pt->dirty[i]);
+	}
 #endif
 
 	spin_lock(&shrinker_lock);
@@ -313,8 +544,14 @@ static void ttm_pool_type_fini(struct ttm_pool_type *pt)
 	list_del(&pt->shrinker_list);
 	spin_unlock(&shrinker_lock);
 
+#ifdef __linux__
 	while ((p = ttm_pool_type_take(pt)))
 		ttm_pool_free_page(pt->pool, pt->caching, pt->order, p);
+#elif defined(__FreeBSD__)
+	ttm_pool_clear_drain();
+	while ((p = ttm_pool_type_reap(pt)))
+		ttm_pool_free_page(pt->pool, pt->caching, pt->order, p);
+#endif
 }
 
 /* Return the pool_type to use for the given caching and order */
@@ -345,6 +582,7 @@ static struct ttm_pool_type *ttm_pool_select_type(struct ttm_pool *pool,
 	return NULL;
 }
 
+#ifdef __linux__
 /* Free pages using the global shrinker list */
 static unsigned int ttm_pool_shrink(void)
 {
@@ -367,6 +605,70 @@ static unsigned int ttm_pool_shrink(void)
 
 	return num_pages;
 }
+#elif defined(__FreeBSD__)
+/*
+ * Free pages of one memory domain, or of any with a negative @domain, using
+ * the global shrinker list.  Unlike on Linux, the pool types are tried in
+ * turn until one of them had pages to give.
+ */
+static unsigned int ttm_pool_shrink_domain(int domain)
+{
+	struct ttm_pool_type *pt, *first = NULL;
+	unsigned int num_pages;
+	struct page *p = NULL;
+
+	spin_lock(&shrinker_lock);
+	while (!p) {
+		pt = list_first_entry(&shrinker_list, typeof(*pt),
+				      shrinker_list);
+		if (pt == first)
+			break;
+		if (!first)
+			first = pt;
+		list_move_tail(&pt->shrinker_list, &shrinker_list);
+
+		if (domain < 0)
+			p = ttm_pool_type_reap(pt);
+		else
+			p = __ttm_pool_type_take(pt, domain, 1, false);
+	}
+	spin_unlock(&shrinker_lock);
+
+	if (p) {
+		ttm_pool_free_page(pt->pool, pt->caching, pt->order, p);
+		num_pages = 1 << pt->order;
+	} else {
+		num_pages = 0;
+	}
+
+	return num_pages;
+}
+
+/* Free pages using the global shrinker list */
+static unsigned int ttm_pool_shrink(void)
+{
+	return ttm_pool_shrink_domain(-1);
+}
+
+/*
+ * Return how much of a domain's pool pages to give back, as a right shift
+ * of their number, for the page shortage the domain is in.  The vm_lowmem
+ * event that invokes the shrinkers may also be raised for a KVA shortage,
+ * in which case only a small share is released.
+ */
+static unsigned int ttm_pool_domain_pressure(int domain)
+{
+	struct vm_domain *vmd = VM_DOMAIN(domain);
+
+	if (vm_paging_severe(vmd))
+		return 0;
+	if (vm_paging_min(vmd))
+		return 1;
+	if (vm_paging_needed(vmd, vmd->vmd_free_count))
+		return 2;
+	return 4;
+}
+#endif
 
 #ifdef __linux__
 /* Return the allocation order based for a page */
@@ -381,8 +683,15 @@ static unsigned int ttm_pool_page_order(struct ttm_pool *pool, struct page *p)
 	return p->private;
 }
 #elif defined(__FreeBSD__)
-/* On FreeBSD, we store the order in a table in `struct ttm_tt` because there
- * is no private field in `struct vm_page` to put ttm_pool data. */
+/* On FreeBSD, there is no private field in `struct vm_page` to put ttm_pool
+ * data. Instead `struct ttm_tt` has a bit set for the first page of every
+ * allocation, so the order of the allocation starting at page @i of the
+ * @num_pages populated ones is given by the distance to the next set bit. */
+static unsigned int ttm_pool_chunk_order(struct ttm_tt *tt, unsigned long i,
+					 unsigned long num_pages)
+{
+	return __fls(find_next_bit(tt->chunks, num_pages, i + 1) - i);
+}
 #endif
 
 /**
@@ -404,9 +713,6 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 	dma_addr_t *dma_addr = tt->dma_address;
 	struct page **caching = tt->pages;
 	struct page **pages = tt->pages;
-#ifdef __FreeBSD__
-	unsigned int *orders = tt->orders;
-#endif
 	gfp_t gfp_flags = GFP_USER;
 	unsigned int i, order;
 	struct page *p;
@@ -433,7 +739,11 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 		struct ttm_pool_type *pt;
 
 		pt = ttm_pool_select_type(pool, tt->caching, order);
+#ifdef __linux__
 		p = pt ? ttm_pool_type_take(pt) : NULL;
+#elif defined(__FreeBSD__)
+		p = pt ? ttm_pool_type_take(pt, ttm_pool_domain(pool)) : NULL;
+#endif
 		if (p) {
 			apply_caching = true;
 		} else {
@@ -470,10 +780,9 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 		for (i = 1 << order; i; --i)
 			*(pages++) = p++;
 #elif defined(__FreeBSD__)
-		for (i = 1 << order; i; --i) {
+		__set_bit(pages - tt->pages, tt->chunks);
+		for (i = 1 << order; i; --i)
 			*(pages++) = p++;
-			*(orders++) = order;
-		}
 #endif
 	}
 
@@ -492,11 +801,14 @@ error_free_all:
 #ifdef __linux__
 		order = ttm_pool_page_order(pool, tt->pages[i]);
 #elif defined(__FreeBSD__)
-		order = tt->orders[i];
+		order = ttm_pool_chunk_order(tt, i, num_pages);
 #endif
 		ttm_pool_free_page(pool, tt->caching, order, tt->pages[i]);
 		i += 1 << order;
 	}
+#ifdef __FreeBSD__
+	bitmap_zero(tt->chunks, tt->num_pages);
+#endif
 
 	return r;
 }
@@ -522,7 +834,7 @@ void ttm_pool_free(struct ttm_pool *pool, struct ttm_tt *tt)
 #ifdef __linux__
 		order = ttm_pool_page_order(pool, p);
 #elif defined(__FreeBSD__)
-		order = tt->orders[i];
+		order = ttm_pool_chunk_order(tt, i, tt->num_pages);
 #endif
 		num_pages = 1ULL << order;
 		if (tt->dma_address)
@@ -537,6 +849,9 @@ void ttm_pool_free(struct ttm_pool *pool, struct ttm_tt *tt)
 
 		i += num_pages;
 	}
+#ifdef __FreeBSD__
+	bitmap_zero(tt->chunks, tt->num_pages);
+#endif
 
 	while (atomic_long_read(&allocated_pages) > page_pool_size)
 		ttm_pool_shrink();
@@ -563,6 +878,12 @@ void ttm_pool_init(struct ttm_pool *pool, struct device *dev,
 	pool->dev = dev;
 	pool->use_dma_alloc = use_dma_alloc;
 	pool->use_dma32 = use_dma32;
+#ifdef __FreeBSD__
+	xa_init(&pool->dma_pages);
+	if (!dev || bus_get_domain(dev->bsddev, &pool->domain) ||
+	    pool->domain >= vm_ndomains)
+		pool->domain = -1;
+#endif
 
 	if (use_dma_alloc) {
 		for (i = 0; i < TTM_NUM_CACHING_TYPES; ++i)
@@ -589,6 +910,10 @@ void ttm_pool_fini(struct ttm_pool *pool)
 			for (j = 0; j < MAX_ORDER; ++j)
 				ttm_pool_type_fini(&pool->caching[i].orders[j]);
 	}
+#ifdef __FreeBSD__
+	WARN_ON(!xa_empty(&pool->dma_pages));
+	xa_destroy(&pool->dma_pages);
+#endif
 
 	/* We removed the pool types from the LRU, but we need to also make sure
 	 * that no shrinker is concurrently freeing pages from the pool.
@@ -596,6 +921,7 @@ void ttm_pool_fini(struct ttm_pool *pool)
 	synchronize_shrinkers();
 }
 
+#ifdef __linux__
 /* As long as pages are available make sure to release at least one */
 static unsigned long ttm_pool_shrinker_scan(struct shrinker *shrink,
 					    struct shrink_control *sc)
@@ -615,19 +941,60 @@ static unsigned long ttm_pool_shrinker_count(struct shrinker *shrink,
 {
 	unsigned long num_pages = atomic_long_read(&allocated_pages);
 
-#ifdef __linux__
 	return num_pages ? num_pages : SHRINK_EMPTY;
+}
 #elif defined(__FreeBSD__)
-	return num_pages ? num_pages : 0;
-#endif
+/* Release up to nr_to_scan pages towards the targets set by the count */
+static unsigned long ttm_pool_shrinker_scan(struct shrinker *shrink,
+					    struct shrink_control *sc)
+{
+	unsigned long num_freed = 0;
+	unsigned int num_pages;
+	int i;
+
+	for (i = 0; i < vm_ndomains && num_freed < sc->nr_to_scan; ++i) {
+		while (num_freed < sc->nr_to_scan &&
+		       atomic_long_read(&shrink_target[i]) > 0) {
+			num_pages = ttm_pool_shrink_domain(i);
+			if (!num_pages) {
+				atomic_long_set(&shrink_target[i], 0);
+				break;
+			}
+			atomic_long_sub(num_pages, &shrink_target[i]);
+			num_freed += num_pages;
+		}
+	}
+
+	return num_freed ? num_freed : SHRINK_STOP;
 }
 
+/* Return the number of pages to release given the pressure on each domain */
+static unsigned long ttm_pool_shrinker_count(struct shrinker *shrink,
+					     struct shrink_control *sc)
+{
+	unsigned long num_pages = 0, target;
+	int i;
+
+	for (i = 0; i < vm_ndomains; ++i) {
+		target = atomic_long_read(&domain_pages[i]) >>
+			ttm_pool_domain_pressure(i);
+		atomic_long_set(&shrink_target[i], target);
+		num_pages += target;
+	}
+
+	return num_pages;
+}
+#endif
+
 #ifdef CONFIG_DEBUG_FS
 /* Count the number of pages available in a pool_type */
 static unsigned int ttm_pool_type_count(struct ttm_pool_type *pt)
 {
 	unsigned int count = 0;
 	struct page *p;
+#ifdef __FreeBSD__
+	int i;
+#endif
 
 	spin_lock(&pt->lock);
 	/* Only used for debugfs, the overhead doesn't matter */
@@ -635,8 +1002,12 @@ static unsigned int ttm_pool_type_count(struct ttm_pool_type *pt)
 	list_for_each_entry(p, &pt->pages, lru)
 		++count;
 #elif defined(__FreeBSD__)
-	TAILQ_FOREACH(p, &pt->pages, plinks.q)
-		++count;
+	for (i = 0; i < vm_ndomains; ++i) {
+		TAILQ_FOREACH(p, &pt->pages[i], plinks.q)
+			++count;
+		TAILQ_FOREACH(p, &pt->dirty[i], plinks.q)
+			++count;
+	}
 #endif
 	spin_unlock(&pt->lock);
 
@@ -668,8 +1039,21 @@ static void ttm_pool_debugfs_orders(struct ttm_pool_type *pt,
 /* Dump the total amount of allocated pages */
 static void ttm_pool_debugfs_footer(struct seq_file *m)
 {
+#ifdef __FreeBSD__
+	int i;
+
+#endif
 	seq_printf(m, "\ntotal\t: %8lu of %8lu\n",
 		   atomic_long_read(&allocated_pages), page_pool_size);
+#ifdef __FreeBSD__
+	seq_printf(m, "clean\t: %8lu\ndirty\t: %8lu\n",
+		   atomic_long_read(&allocated_pages) -
+		   atomic_long_read(&dirty_pages),
+		   atomic_long_read(&dirty_pages));
+	for (i = 0; i < vm_ndomains; ++i)
+		seq_printf(m, "domain %d: %8lu\n", i,
+			   atomic_long_read(&domain_pages[i]));
+#endif
 }
 
 /* Dump the information for the global pools */
@@ -740,10 +1124,24 @@ EXPORT_SYMBOL(ttm_pool_debugfs);
 static int ttm_pool_debugfs_shrink_show(struct seq_file *m, void *data)
 {
 	struct shrink_control sc = { .gfp_mask = GFP_NOFS };
+#ifdef __FreeBSD__
+	unsigned long count, freed = 0;
+#endif
 
 	fs_reclaim_acquire(GFP_KERNEL);
+#ifdef __linux__
 	seq_printf(m, "%lu/%lu\n", ttm_pool_shrinker_count(&mm_shrinker, &sc),
 		   ttm_pool_shrinker_scan(&mm_shrinker, &sc));
+#elif defined(__FreeBSD__)
+	/* The count sets the targets the scan releases, so it goes first. */
+	count = ttm_pool_shrinker_count(&mm_shrinker, &sc);
+	sc.nr_to_scan = count;
+	if (count != 0)
+		freed = ttm_pool_shrinker_scan(&mm_shrinker, &sc);
+	if (freed == SHRINK_STOP)
+		freed = 0;
+	seq_printf(m, "%lu/%lu\n", count, freed);
+#endif
 	fs_reclaim_release(GFP_KERNEL);
 
 	return 0;
@@ -769,6 +1167,19 @@ int ttm_pool_mgr_init(unsigned long num_pages)
 	spin_lock_init(&shrinker_lock);
 	INIT_LIST_HEAD(&shrinker_list);
 
+#ifdef __FreeBSD__
+	for (i = 0; i < vm_ndomains; ++i) {
+		TASK_INIT(&clear_task[i], 0, ttm_pool_clear_work,
+			  (void *)(uintptr_t)i);
+		clear_tq[i] = taskqueue_create("ttm_pool_clear", M_WAITOK,
+					       taskqueue_thread_enqueue,
+					       &clear_tq[i]);
+		taskqueue_start_threads_cpuset(&clear_tq[i], 1, PWAIT,
+					       &cpuset_domain[i],
+					       "ttm pool clear dom%d", i);
+	}
+#endif
+
 	for (i = 0; i < MAX_ORDER; ++i) {
 		ttm_pool_type_init(&global_write_combined[i], NULL,
 				   ttm_write_combined, i);
@@ -812,4 +1223,11 @@ void ttm_pool_mgr_fini(void)
 
 	unregister_shrinker(&mm_shrinker);
 	WARN_ON(!list_empty(&shrinker_list));
+
+#ifdef __FreeBSD__
+	for (i = 0; i < vm_ndomains; ++i) {
+		taskqueue_free(clear_tq[i]);
+		clear_tq[i] = NULL;
+	}
+#endif
 }
@@ -102,14 +102,14 @@ static int ttm_tt_alloc_page_directory(struct ttm_tt *ttm)
 #ifdef __linux__
 	ttm->pages = kvcalloc(ttm->num_pages, sizeof(void*), GFP_KERNEL);
 #elif defined(__FreeBSD__)
-	ttm->pages = kvcalloc(ttm->num_pages,
-			      sizeof(*ttm->pages) + sizeof(*ttm->orders),
-			      GFP_KERNEL);
+	ttm->pages = kvzalloc(ttm->num_pages * sizeof(*ttm->pages) +
+			      BITS_TO_LONGS(ttm->num_pages) *
+			      sizeof(*ttm->chunks), GFP_KERNEL);
 #endif
 	if (!ttm->pages)
 		return -ENOMEM;
 #ifdef __FreeBSD__
-	ttm->orders = (void *)(ttm->pages + ttm->num_pages);
+	ttm->chunks = (void *)(ttm->pages + ttm->num_pages);
 #endif
 
 	return 0;
@@ -121,16 +121,17 @@ static int ttm_dma_tt_alloc_page_directory(struct ttm_tt *ttm)
 	ttm->pages = kvcalloc(ttm->num_pages, sizeof(*ttm->pages) +
 			      sizeof(*ttm->dma_address), GFP_KERNEL);
 #elif defined(__FreeBSD__)
-	ttm->pages = kvcalloc(ttm->num_pages, sizeof(*ttm->pages) +
-			      sizeof(*ttm->dma_address) + sizeof(*ttm->orders),
-			      GFP_KERNEL);
+	ttm->pages = kvzalloc(ttm->num_pages * (sizeof(*ttm->pages) +
+			      sizeof(*ttm->dma_address)) +
+			      BITS_TO_LONGS(ttm->num_pages) *
+			      sizeof(*ttm->chunks), GFP_KERNEL);
 #endif
 	if (!ttm->pages)
 		return -ENOMEM;
 
 	ttm->dma_address = (void *)(ttm->pages + ttm->num_pages);
 #ifdef __FreeBSD__
-	ttm->orders = (void *)(ttm->dma_address + ttm->num_pages);
+	ttm->chunks = (void *)(ttm->dma_address + ttm->num_pages);
 #endif
 	return 0;
 }
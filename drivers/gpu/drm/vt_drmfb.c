@@ -233,6 +233,9 @@ vt_drmfb_postswitch(struct vt_device *vd)
 			EVENTHANDLER_INVOKE(shutdown_final, RB_NOSYNC);
 		}
 
+		/* The flush task cannot run from here on. */
+		linux_fb_shadow_flush(info);
+
 		if (vd->vd_grabwindow != NULL) {
 			if (info->fbops->fb_debug_enter)
 				info->fbops->fb_debug_enter(info);
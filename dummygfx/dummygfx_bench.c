@@ -0,0 +1,394 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice unmodified, this list of conditions, and the following
+ *    disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Micro-benchmarks for DRM core code that can run without a GPU.
+ *
+ * Each benchmark is a read-only debugfs file under dummygfx/; reading it
+ * runs the benchmark and prints the results, e.g.
+ *
+ *	cat /sys/kernel/debug/dummygfx/drm_mm_bench
+ *	cat /sys/kernel/debug/dummygfx/fb_bench
+ *
+ * The drm_sched benchmark lives in dummygfx_sched_bench.c.
+ */
+
+#include <sys/param.h>
+#include <sys/systm.h>
+
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <linux/fb.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+
+#include <drm/drm_mm.h>
+
+#include "dummygfx_drv.h"
+
+static unsigned int drm_mm_bench_nodes = 1 << 17;
+module_param_named(drm_mm_bench_nodes, drm_mm_bench_nodes, uint, 0644);
+MODULE_PARM_DESC(drm_mm_bench_nodes, "Number of nodes used by drm_mm_bench");
+
+/* Deterministic xorshift so that runs are comparable. */
+static inline u32
+bench_rand(u32 *state)
+{
+	u32 x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return (*state = x);
+}
+
+static void
+bench_report(struct seq_file *m, const char *what, u64 ns, unsigned int count)
+{
+	seq_printf(m, "%-24s %8u ops %12llu ns %8llu ns/op\n", what, count,
+	    (unsigned long long)ns,
+	    (unsigned long long)(count ? div64_u64(ns, count) : 0));
+}
+
+/*
+ * drm_mm stress test
+ *
+ * Fill a range with nodes of random size, punch every other node out to
+ * fragment the address space, then measure LOW/HIGH/BEST insertion,
+ * removal and eviction scans against the fragmented allocator.  The
+ * LOW/HIGH and eviction paths rely on the augmented rbtrees, so these
+ * numbers grow linearly rather than logarithmically if they go stale.
+ */
+static int
+drm_mm_bench_show(struct seq_file *m, void *unused)
+{
+	static const struct {
+		const char *name;
+		enum drm_mm_insert_mode mode;
+	} modes[] = {
+		{ "insert_best", DRM_MM_INSERT_BEST },
+		{ "insert_low", DRM_MM_INSERT_LOW },
+		{ "insert_high", DRM_MM_INSERT_HIGH },
+	};
+	struct drm_mm_node *nodes, *extra;
+	struct drm_mm_scan scan;
+	struct drm_mm mm;
+	unsigned int count, i, j, k, scans;
+	u64 t, total, size;
+	u32 seed = 0x2545f491;
+	int ret = 0;
+
+	count = max(drm_mm_bench_nodes, 1024u);
+	nodes = kvcalloc(count, sizeof(*nodes), GFP_KERNEL);
+	extra = kvcalloc(count / 2, sizeof(*extra), GFP_KERNEL);
+	if (nodes == NULL || extra == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	/* Pages of 4K, nodes between 1 and 16 pages. */
+	size = (u64)count * 16 * PAGE_SIZE;
+	drm_mm_init(&mm, 0, size);
+
+	seq_printf(m, "drm_mm: %u nodes, %llu bytes\n", count,
+	    (unsigned long long)size);
+
+	t = ktime_get_ns();
+	for (i = 0; i < count; i++) {
+		ret = drm_mm_insert_node(&mm, &nodes[i],
+		    ((bench_rand(&seed) & 15) + 1) * PAGE_SIZE);
+		if (ret != 0)
+			goto fini;
+	}
+	bench_report(m, "fill", ktime_get_ns() - t, count);
+
+	t = ktime_get_ns();
+	for (i = 0; i < count; i += 2)
+		drm_mm_remove_node(&nodes[i]);
+	bench_report(m, "remove", ktime_get_ns() - t, count / 2);
+
+	/* Each mode fills a third of the holes, then gives them back. */
+	for (k = 0; k < ARRAY_SIZE(modes); k++) {
+		unsigned int n = count / 2 / ARRAY_SIZE(modes);
+
+		t = ktime_get_ns();
+		for (j = 0; j < n; j++) {
+			if (drm_mm_insert_node_generic(&mm, &extra[j],
+			    ((bench_rand(&seed) & 7) + 1) * PAGE_SIZE, 0, 0,
+			    modes[k].mode) != 0)
+				break;
+		}
+		bench_report(m, modes[k].name, ktime_get_ns() - t, j);
+		while (j-- > 0)
+			drm_mm_remove_node(&extra[j]);
+	}
+
+	/*
+	 * Eviction scans walk the surviving (odd) nodes in "LRU" order from a
+	 * random starting point until a hole of the requested size forms.
+	 */
+	total = 0;
+	scans = 256;
+	for (k = 0; k < scans; k++) {
+		unsigned int first = (bench_rand(&seed) % (count / 2)) * 2 + 1;
+
+		t = ktime_get_ns();
+		drm_mm_scan_init(&scan, &mm,
+		    ((bench_rand(&seed) & 63) + 32) * PAGE_SIZE, 0, 0,
+		    DRM_MM_INSERT_EVICT);
+		for (i = first; i < count; i += 2) {
+			if (drm_mm_scan_add_block(&scan, &nodes[i]))
+				break;
+		}
+		if (i >= count)
+			i -= 2;
+		for (;; i -= 2) {
+			drm_mm_scan_remove_block(&scan, &nodes[i]);
+			if (i == first)
+				break;
+		}
+		total += ktime_get_ns() - t;
+	}
+	bench_report(m, "evict_scan", total, scans);
+
+	t = ktime_get_ns();
+	for (i = 1; i < count; i += 2)
+		drm_mm_remove_node(&nodes[i]);
+	bench_report(m, "drain", ktime_get_ns() - t, count / 2);
+
+fini:
+	if (ret != 0) {
+		seq_printf(m, "drm_mm: insert failed: %d\n", ret);
+		for (i = 0; i < count; i++) {
+			if (drm_mm_node_allocated(&nodes[i]))
+				drm_mm_remove_node(&nodes[i]);
+		}
+	}
+	drm_mm_takedown(&mm);
+out:
+	kvfree(extra);
+	kvfree(nodes);
+	return ret;
+}
+
+static int
+drm_mm_bench_open(struct inode *inode, struct file *file)
+{
+
+	return single_open(file, drm_mm_bench_show, inode->i_private);
+}
+
+static const struct file_operations drm_mm_bench_fops = {
+	.owner = THIS_MODULE,
+	.open = drm_mm_bench_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * Console drawing benchmark
+ *
+ * Draws to a 3840x2160 framebuffer in system memory the way vt(4) does: a
+ * full-screen blank followed by a screen full of 8x16 glyphs.  The same
+ * operations are also done with a naive per-pixel loop for reference.  Real
+ * VRAM is uncached or write-combined, so the gap there is larger still.
+ */
+#define	FB_BENCH_WIDTH	3840
+#define	FB_BENCH_HEIGHT	2160
+#define	FB_BENCH_GLYPH_W	8
+#define	FB_BENCH_GLYPH_H	16
+
+static void
+fb_bench_naive_pixel(struct linux_fb_info *info, uint32_t x, uint32_t y,
+    uint32_t color)
+{
+	uint8_t *p;
+
+	p = (uint8_t *)info->screen_base + info->fix.line_length * y +
+	    x * (info->var.bits_per_pixel / 8);
+	switch (info->var.bits_per_pixel) {
+	case 8:
+		*(volatile uint8_t *)p = color;
+		break;
+	case 16:
+		*(volatile uint16_t *)p = color;
+		break;
+	case 32:
+		*(volatile uint32_t *)p = color;
+		break;
+	}
+}
+
+static void
+fb_bench_naive_fill(struct linux_fb_info *info, uint32_t color)
+{
+	uint32_t x, y;
+
+	for (y = 0; y < info->var.yres; y++)
+		for (x = 0; x < info->var.xres; x++)
+			fb_bench_naive_pixel(info, x, y, color);
+}
+
+static void
+fb_bench_naive_blit(struct linux_fb_info *info, const struct fb_image *image)
+{
+	uint32_t xi, yi, stride, color;
+
+	stride = howmany(image->width, 8);
+	for (yi = 0; yi < image->height; yi++) {
+		for (xi = 0; xi < image->width; xi++) {
+			color = image->data[yi * stride + xi / 8] &
+			    (0x80 >> (xi % 8)) ?
+			    image->fg_color : image->bg_color;
+			fb_bench_naive_pixel(info, image->dx + xi,
+			    image->dy + yi, color);
+		}
+	}
+}
+
+static uint64_t
+fb_bench_screen(struct linux_fb_info *info, bool naive)
+{
+	static const uint8_t glyph[FB_BENCH_GLYPH_H] = {
+		0x00, 0x00, 0x10, 0x38, 0x6c, 0xc6, 0xc6, 0xfe,
+		0xc6, 0xc6, 0xc6, 0xc6, 0x00, 0x00, 0x00, 0x00,
+	};
+	struct fb_fillrect rect;
+	struct fb_image image;
+	uint64_t start;
+	uint32_t x, y;
+
+	start = get_cyclecount();
+
+	rect.dx = rect.dy = 0;
+	rect.width = info->var.xres;
+	rect.height = info->var.yres;
+	rect.color = 0;
+	rect.rop = ROP_COPY;
+	if (naive)
+		fb_bench_naive_fill(info, rect.color);
+	else
+		cfb_fillrect(info, &rect);
+
+	memset(&image, 0, sizeof(image));
+	image.width = FB_BENCH_GLYPH_W;
+	image.height = FB_BENCH_GLYPH_H;
+	image.fg_color = 0xaaaaaa;
+	image.bg_color = 0;
+	image.depth = 1;
+	image.data = (const char *)glyph;
+	for (y = 0; y + FB_BENCH_GLYPH_H <= info->var.yres;
+	    y += FB_BENCH_GLYPH_H) {
+		for (x = 0; x + FB_BENCH_GLYPH_W <= info->var.xres;
+		    x += FB_BENCH_GLYPH_W) {
+			image.dx = x;
+			image.dy = y;
+			if (naive)
+				fb_bench_naive_blit(info, &image);
+			else
+				cfb_imageblit(info, &image);
+		}
+	}
+
+	return (get_cyclecount() - start);
+}
+
+static int
+fb_bench_show(struct seq_file *m, void *unused)
+{
+	static const uint32_t depths[] = { 8, 16, 32 };
+	struct linux_fb_info *info;
+	uint64_t naive, cfb;
+	int i;
+
+	info = framebuffer_alloc(0, NULL);
+	info->var.xres = FB_BENCH_WIDTH;
+	info->var.yres = FB_BENCH_HEIGHT;
+	info->screen_size = FB_BENCH_WIDTH * FB_BENCH_HEIGHT * 4;
+	info->screen_buffer = kvzalloc(info->screen_size, GFP_KERNEL);
+	if (info->screen_buffer == NULL) {
+		framebuffer_release(info);
+		return (-ENOMEM);
+	}
+
+	seq_printf(m, "fb: %ux%u, blank + %ux%u glyphs, cycles\n",
+	    FB_BENCH_WIDTH, FB_BENCH_HEIGHT, FB_BENCH_GLYPH_W,
+	    FB_BENCH_GLYPH_H);
+	for (i = 0; i < ARRAY_SIZE(depths); i++) {
+		info->var.bits_per_pixel = depths[i];
+		info->fix.line_length = FB_BENCH_WIDTH * depths[i] / 8;
+
+		naive = fb_bench_screen(info, true);
+		cfb = fb_bench_screen(info, false);
+		seq_printf(m, "%2ubpp naive %14ju cfb %14ju speedup %ju.%02jux\n",
+		    depths[i], (uintmax_t)naive, (uintmax_t)cfb,
+		    (uintmax_t)(naive / MAX(cfb, 1)),
+		    (uintmax_t)(naive * 100 / MAX(cfb, 1) % 100));
+	}
+
+	kvfree(info->screen_buffer);
+	framebuffer_release(info);
+	return (0);
+}
+
+static int
+fb_bench_open(struct inode *inode, struct file *file)
+{
+
+	return single_open(file, fb_bench_show, inode->i_private);
+}
+
+static const struct file_operations fb_bench_fops = {
+	.owner = THIS_MODULE,
+	.open = fb_bench_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+int
+dummygfx_bench_init(struct dentry *root)
+{
+	struct dentry *d;
+
+	d = debugfs_create_file("drm_mm_bench", S_IRUSR, root, NULL,
+	    &drm_mm_bench_fops);
+	if (!d) {
+		DRM_ERROR("Cannot create debugfs drm_mm_bench\n");
+		return -ENOMEM;
+	}
+	d = debugfs_create_file("fb_bench", S_IRUSR, root, NULL,
+	    &fb_bench_fops);
+	if (!d) {
+		DRM_ERROR("Cannot create debugfs fb_bench\n");
+		return -ENOMEM;
+	}
+	if (dummygfx_sched_bench_init(root) != 0)
+		return -ENOMEM;
+	return dummygfx_dmabuf_test_init(root);
+}
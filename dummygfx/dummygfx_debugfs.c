@@ -255,7 +255,7 @@ int dummygfx_debugfs_init()
 		DRM_ERROR("Cannot create debugfs attr\n");
 		return -ENOMEM;
 	}
-	return 0;
+	return dummygfx_bench_init(debugfs_root);
 }
 
 void dummygfx_debugfs_exit()
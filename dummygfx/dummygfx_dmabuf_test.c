@@ -0,0 +1,622 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice unmodified, this list of conditions, and the following
+ *    disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * dma-buf tests against a mock exporter.
+ *
+ * Each test is a read-only debugfs file under dummygfx/; reading it runs
+ * the test and prints PASS or FAIL with the details, e.g.
+ *
+ *	cat /sys/kernel/debug/dummygfx/dmabuf_kqueue_test
+ *	cat /sys/kernel/debug/dummygfx/dmabuf_move_test
+ */
+
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/event.h>
+#include <sys/fcntl.h>
+#include <sys/proc.h>
+#include <sys/syscallsubr.h>
+
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-fence.h>
+#include <linux/dma-resv.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+
+#include "dummygfx_drv.h"
+
+/*
+ * Freed by the release of its dma-buf, which may outlive the test.  The
+ * fields below are only used by the dynamic ops.
+ */
+struct dmabuf_test_exporter {
+	atomic_t		pins;
+	atomic_t		maps;
+	atomic_t		unmaps;
+	bool			pin_underflow;
+	u_int			gen;		/* placement, under resv */
+	struct list_head	mappings;	/* under resv */
+};
+
+/*
+ * Mappings are only marked unmapped and kept until release, so that an
+ * importer still using one after its unmap is caught instead of touching
+ * freed memory.
+ */
+struct dmabuf_test_mapping {
+	struct sg_table		sgt;
+	struct list_head	node;
+	u_int			gen;
+	bool			unmapped;
+};
+
+static void
+dmabuf_test_release(struct dma_buf *db)
+{
+	struct dmabuf_test_exporter *exp = db->priv;
+	struct dmabuf_test_mapping *map, *tmp;
+
+	list_for_each_entry_safe(map, tmp, &exp->mappings, node)
+		kfree(map);
+	kfree(exp);
+}
+
+static const struct dma_buf_ops dmabuf_test_ops = {
+	.release = dmabuf_test_release,
+};
+
+static int
+dmabuf_test_pin(struct dma_buf_attachment *dba)
+{
+	struct dmabuf_test_exporter *exp = dba->dmabuf->priv;
+
+	atomic_inc(&exp->pins);
+	return (0);
+}
+
+static void
+dmabuf_test_unpin(struct dma_buf_attachment *dba)
+{
+	struct dmabuf_test_exporter *exp = dba->dmabuf->priv;
+
+	if (atomic_dec_return(&exp->pins) < 0)
+		exp->pin_underflow = true;
+}
+
+static struct sg_table *
+dmabuf_test_map_dma_buf(struct dma_buf_attachment *dba,
+    enum dma_data_direction dir)
+{
+	struct dmabuf_test_exporter *exp = dba->dmabuf->priv;
+	struct dmabuf_test_mapping *map;
+
+	dma_resv_assert_held(dba->dmabuf->resv);
+	map = kzalloc(sizeof(*map), GFP_KERNEL);
+	if (map == NULL)
+		return (ERR_PTR(-ENOMEM));
+	map->gen = exp->gen;
+	list_add_tail(&map->node, &exp->mappings);
+	atomic_inc(&exp->maps);
+	return (&map->sgt);
+}
+
+static void
+dmabuf_test_unmap_dma_buf(struct dma_buf_attachment *dba,
+    struct sg_table *sgt, enum dma_data_direction dir)
+{
+	struct dmabuf_test_exporter *exp = dba->dmabuf->priv;
+	struct dmabuf_test_mapping *map;
+
+	dma_resv_assert_held(dba->dmabuf->resv);
+	map = container_of(sgt, struct dmabuf_test_mapping, sgt);
+	map->unmapped = true;
+	atomic_inc(&exp->unmaps);
+}
+
+/* A dynamic exporter which may move the buffer whenever it is unpinned. */
+static const struct dma_buf_ops dmabuf_test_dynamic_ops = {
+	.pin = dmabuf_test_pin,
+	.unpin = dmabuf_test_unpin,
+	.map_dma_buf = dmabuf_test_map_dma_buf,
+	.unmap_dma_buf = dmabuf_test_unmap_dma_buf,
+	.release = dmabuf_test_release,
+};
+
+static struct dma_buf *
+dmabuf_test_export(const struct dma_buf_ops *ops,
+    struct dmabuf_test_exporter **expp)
+{
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+	struct dmabuf_test_exporter *exp;
+	struct dma_buf *db;
+
+	exp = kzalloc(sizeof(*exp), GFP_KERNEL);
+	if (exp == NULL)
+		return (ERR_PTR(-ENOMEM));
+	INIT_LIST_HEAD(&exp->mappings);
+	exp_info.ops = ops;
+	exp_info.size = PAGE_SIZE;
+	exp_info.priv = exp;
+	db = dma_buf_export(&exp_info);
+	if (IS_ERR(db))
+		kfree(exp);
+	else if (expp != NULL)
+		*expp = exp;
+	return (db);
+}
+
+static DEFINE_SPINLOCK(dmabuf_test_fence_lock);
+
+static const char *
+dmabuf_test_fence_get_driver_name(struct dma_fence *fence)
+{
+
+	return ("dummygfx");
+}
+
+static const char *
+dmabuf_test_fence_get_timeline_name(struct dma_fence *fence)
+{
+
+	return ("dmabuf_test");
+}
+
+static const struct dma_fence_ops dmabuf_test_fence_ops = {
+	.get_driver_name = dmabuf_test_fence_get_driver_name,
+	.get_timeline_name = dmabuf_test_fence_get_timeline_name,
+};
+
+/* Adds a new unsignaled write fence to @db, returns it referenced. */
+static struct dma_fence *
+dmabuf_test_add_fence(struct dma_buf *db, u64 context, u64 seqno)
+{
+	struct dma_fence *fence;
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (fence == NULL)
+		return (NULL);
+	dma_fence_init(fence, &dmabuf_test_fence_ops,
+	    &dmabuf_test_fence_lock, context, seqno);
+
+	dma_resv_lock(db->resv, NULL);
+	if (dma_resv_reserve_fences(db->resv, 1) != 0) {
+		dma_resv_unlock(db->resv);
+		dma_fence_put(fence);
+		return (NULL);
+	}
+	dma_resv_add_fence(db->resv, fence, DMA_RESV_USAGE_WRITE);
+	dma_resv_unlock(db->resv);
+
+	return (fence);
+}
+
+struct dmabuf_test_kevents {
+	struct kevent		*changes;
+	struct kevent		*events;
+};
+
+static int
+dmabuf_test_kevent_copyin(void *arg, struct kevent *kevp, int count)
+{
+	struct dmabuf_test_kevents *k = arg;
+
+	memcpy(kevp, k->changes, count * sizeof(*kevp));
+	k->changes += count;
+	return (0);
+}
+
+static int
+dmabuf_test_kevent_copyout(void *arg, struct kevent *kevp, int count)
+{
+	struct dmabuf_test_kevents *k = arg;
+
+	memcpy(k->events, kevp, count * sizeof(*kevp));
+	k->events += count;
+	return (0);
+}
+
+/*
+ * kevent(2) on @kq from the kernel, returns the number of events or a
+ * negative error.
+ */
+static int
+dmabuf_test_kevent(int kq, struct kevent *change, struct kevent *event,
+    int timeout_ms)
+{
+	struct dmabuf_test_kevents k = {
+		.changes = change,
+		.events = event,
+	};
+	struct kevent_copyops k_ops = {
+		.arg = &k,
+		.k_copyout = dmabuf_test_kevent_copyout,
+		.k_copyin = dmabuf_test_kevent_copyin,
+		.kevent_size = sizeof(struct kevent),
+	};
+	struct timespec ts = {
+		.tv_sec = timeout_ms / 1000,
+		.tv_nsec = (timeout_ms % 1000) * 1000000,
+	};
+	struct thread *td = curthread;
+	int error;
+
+	error = kern_kevent(td, kq, change != NULL, event != NULL, &k_ops,
+	    &ts);
+	if (error != 0)
+		return (-error);
+	return (td->td_retval[0]);
+}
+
+/*
+ * A single level-triggered EVFILT_READ registration has to see the
+ * buffer become readable for each new generation of write fences, not
+ * only for the fences present when it was registered.
+ */
+static int
+dmabuf_kqueue_test_show(struct seq_file *m, void *unused)
+{
+	struct thread *td = curthread;
+	struct kevent kev, ev;
+	struct dma_fence *fence;
+	struct dma_buf *db;
+	u64 context;
+	int fd, kq, gen, n, failed;
+
+	db = dmabuf_test_export(&dmabuf_test_ops, NULL);
+	if (IS_ERR(db))
+		return (PTR_ERR(db));
+	fd = dma_buf_fd(db, O_CLOEXEC);
+	if (fd < 0) {
+		dma_buf_put(db);
+		return (fd);
+	}
+	if (kern_kqueue(td, 0, NULL) != 0) {
+		kern_close(td, fd);
+		return (-ENOMEM);
+	}
+	kq = td->td_retval[0];
+
+	context = dma_fence_context_alloc(1);
+	failed = 0;
+	for (gen = 0; gen < 2 && failed == 0; gen++) {
+		fence = dmabuf_test_add_fence(db, context, gen + 1);
+		if (fence == NULL) {
+			seq_printf(m, "gen %d: cannot add fence\n", gen);
+			failed++;
+			break;
+		}
+
+		/* Registered once, while the first fence is pending. */
+		if (gen == 0) {
+			EV_SET(&kev, fd, EVFILT_READ, EV_ADD, 0, 0, NULL);
+			n = dmabuf_test_kevent(kq, &kev, NULL, 0);
+			if (n < 0) {
+				seq_printf(m, "register: error %d\n", n);
+				failed++;
+			}
+		}
+
+		n = dmabuf_test_kevent(kq, NULL, &ev, 0);
+		if (n != 0) {
+			seq_printf(m, "gen %d: readable while busy (%d)\n",
+			    gen, n);
+			failed++;
+		}
+
+		dma_fence_signal(fence);
+		dma_fence_put(fence);
+
+		n = dmabuf_test_kevent(kq, NULL, &ev, 1000);
+		if (n != 1 || ev.ident != (uintptr_t)fd) {
+			seq_printf(m, "gen %d: no event once idle (%d)\n",
+			    gen, n);
+			failed++;
+		}
+	}
+
+	kern_close(td, kq);
+	kern_close(td, fd);
+
+	seq_printf(m, "dmabuf_kqueue_test: %s\n", failed ? "FAIL" : "PASS");
+	return (0);
+}
+
+static int
+dmabuf_kqueue_test_open(struct inode *inode, struct file *file)
+{
+
+	return single_open(file, dmabuf_kqueue_test_show, inode->i_private);
+}
+
+static const struct file_operations dmabuf_kqueue_test_fops = {
+	.owner = THIS_MODULE,
+	.open = dmabuf_kqueue_test_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+#define	DMABUF_MOVE_TEST_IMPORTERS	2
+#define	DMABUF_MOVE_TEST_LOOPS		10000
+
+/* attach wants a device, the mock exporter never looks at it. */
+static struct device dmabuf_move_test_dev;
+
+struct dmabuf_move_test_importer {
+	struct dma_buf_attachment *att;
+	struct dmabuf_test_exporter *exp;
+	struct sg_table		*sgt;		/* under resv */
+	u_int			stale;
+	int			error;
+	struct completion	done;
+	struct task_struct	*thread;
+};
+
+static void
+dmabuf_move_test_move_notify(struct dma_buf_attachment *att)
+{
+	struct dmabuf_move_test_importer *imp = att->importer_priv;
+
+	if (imp->sgt != NULL) {
+		dma_buf_unmap_attachment(att, imp->sgt, DMA_BIDIRECTIONAL);
+		imp->sgt = NULL;
+	}
+}
+
+static const struct dma_buf_attach_ops dmabuf_move_test_attach_ops = {
+	.move_notify = dmabuf_move_test_move_notify,
+};
+
+/*
+ * Uses its mapping under the reservation lock, mapping again whenever a
+ * move dropped it and unmapping now and then by itself.  A mapping from
+ * before the last move, or one already unmapped, is a stale use.
+ */
+static int
+dmabuf_move_test_importer_fn(void *arg)
+{
+	struct dmabuf_move_test_importer *imp = arg;
+	struct dmabuf_test_mapping *map;
+	struct dma_buf *db = imp->att->dmabuf;
+	struct sg_table *sgt;
+	int i;
+
+	for (i = 0; i < DMABUF_MOVE_TEST_LOOPS; i++) {
+		dma_resv_lock(db->resv, NULL);
+		if (imp->sgt == NULL) {
+			sgt = dma_buf_map_attachment(imp->att,
+			    DMA_BIDIRECTIONAL);
+			if (IS_ERR(sgt)) {
+				dma_resv_unlock(db->resv);
+				imp->error = PTR_ERR(sgt);
+				break;
+			}
+			imp->sgt = sgt;
+		}
+		map = container_of(imp->sgt, struct dmabuf_test_mapping, sgt);
+		if (map->unmapped || map->gen != imp->exp->gen)
+			imp->stale++;
+		if ((i & 15) == 15) {
+			dma_buf_unmap_attachment(imp->att, imp->sgt,
+			    DMA_BIDIRECTIONAL);
+			imp->sgt = NULL;
+		}
+		dma_resv_unlock(db->resv);
+		cond_resched();
+	}
+	complete(&imp->done);
+
+	/* Stay around for kthread_stop(). */
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return (0);
+}
+
+/* Moves the buffer whenever nobody has it pinned. */
+static int
+dmabuf_move_test_mover_fn(void *arg)
+{
+	struct dma_buf *db = arg;
+	struct dmabuf_test_exporter *exp = db->priv;
+
+	while (!kthread_should_stop()) {
+		dma_resv_lock(db->resv, NULL);
+		if (atomic_read(&exp->pins) == 0) {
+			exp->gen++;
+			dma_buf_move_notify(db);
+		}
+		dma_resv_unlock(db->resv);
+		cond_resched();
+	}
+	return (0);
+}
+
+/*
+ * Dynamic importers of a dynamic exporter race dma_buf_move_notify()
+ * against dma_buf_map_attachment() and dma_buf_unmap_attachment().  No
+ * mapping may be used after the move which invalidated it, every map has
+ * to be unmapped again, and the importers must never pin.  A static
+ * importer attached afterwards has to hold exactly one pin until detach.
+ */
+static int
+dmabuf_move_test_show(struct seq_file *m, void *unused)
+{
+	struct dmabuf_move_test_importer imps[DMABUF_MOVE_TEST_IMPORTERS];
+	struct dmabuf_test_exporter *exp;
+	struct dma_buf_attachment *att;
+	struct task_struct *mover;
+	struct dma_buf *db;
+	u_int gen;
+	int i, nimps, failed;
+
+	db = dmabuf_test_export(&dmabuf_test_dynamic_ops, &exp);
+	if (IS_ERR(db))
+		return (PTR_ERR(db));
+
+	failed = 0;
+	memset(imps, 0, sizeof(imps));
+	for (nimps = 0; nimps < DMABUF_MOVE_TEST_IMPORTERS; nimps++) {
+		imps[nimps].exp = exp;
+		init_completion(&imps[nimps].done);
+		att = dma_buf_dynamic_attach(db, &dmabuf_move_test_dev,
+		    &dmabuf_move_test_attach_ops, &imps[nimps]);
+		if (IS_ERR(att)) {
+			seq_printf(m, "dynamic attach: error %ld\n",
+			    PTR_ERR(att));
+			failed++;
+			break;
+		}
+		imps[nimps].att = att;
+	}
+
+	mover = NULL;
+	if (failed == 0)
+		mover = kthread_run(dmabuf_move_test_mover_fn, db,
+		    "dmabuf_mover");
+	if (IS_ERR(mover)) {
+		seq_printf(m, "mover: error %ld\n", PTR_ERR(mover));
+		failed++;
+		mover = NULL;
+	}
+	for (i = 0; mover != NULL && i < nimps; i++) {
+		imps[i].thread = kthread_run(dmabuf_move_test_importer_fn,
+		    &imps[i], "dmabuf_importer");
+		if (IS_ERR(imps[i].thread)) {
+			seq_printf(m, "importer %d: error %ld\n", i,
+			    PTR_ERR(imps[i].thread));
+			imps[i].thread = NULL;
+			failed++;
+		}
+	}
+	for (i = 0; i < nimps; i++) {
+		if (imps[i].thread == NULL)
+			continue;
+		wait_for_completion(&imps[i].done);
+		kthread_stop(imps[i].thread);
+	}
+	if (mover != NULL)
+		kthread_stop(mover);
+
+	for (i = 0; i < nimps; i++) {
+		if (imps[i].error != 0) {
+			seq_printf(m, "importer %d: map error %d\n", i,
+			    imps[i].error);
+			failed++;
+		}
+		if (imps[i].stale != 0) {
+			seq_printf(m, "importer %d: %u stale mappings used\n",
+			    i, imps[i].stale);
+			failed++;
+		}
+		dma_resv_lock(db->resv, NULL);
+		if (imps[i].sgt != NULL) {
+			dma_buf_unmap_attachment(imps[i].att, imps[i].sgt,
+			    DMA_BIDIRECTIONAL);
+			imps[i].sgt = NULL;
+		}
+		dma_resv_unlock(db->resv);
+		dma_buf_detach(db, imps[i].att);
+	}
+	gen = exp->gen;
+	if (atomic_read(&exp->pins) != 0 || exp->pin_underflow) {
+		seq_printf(m, "dynamic importers left %d pins\n",
+		    atomic_read(&exp->pins));
+		failed++;
+	}
+
+	/* A static importer is mapped and pinned for as long as attached. */
+	att = dma_buf_attach(db, &dmabuf_move_test_dev);
+	if (IS_ERR(att)) {
+		seq_printf(m, "static attach: error %ld\n", PTR_ERR(att));
+		failed++;
+	} else {
+		if (atomic_read(&exp->pins) != 1) {
+			seq_printf(m, "static attach: %d pins\n",
+			    atomic_read(&exp->pins));
+			failed++;
+		}
+		dma_buf_detach(db, att);
+	}
+	if (atomic_read(&exp->pins) != 0 || exp->pin_underflow) {
+		seq_printf(m, "static detach: %d pins\n",
+		    atomic_read(&exp->pins));
+		failed++;
+	}
+	if (atomic_read(&exp->maps) != atomic_read(&exp->unmaps)) {
+		seq_printf(m, "%d maps, %d unmaps\n", atomic_read(&exp->maps),
+		    atomic_read(&exp->unmaps));
+		failed++;
+	}
+
+	seq_printf(m, "%u moves, %d maps\n", gen, atomic_read(&exp->maps));
+	dma_buf_put(db);
+
+	seq_printf(m, "dmabuf_move_test: %s\n", failed ? "FAIL" : "PASS");
+	return (0);
+}
+
+static int
+dmabuf_move_test_open(struct inode *inode, struct file *file)
+{
+
+	return single_open(file, dmabuf_move_test_show, inode->i_private);
+}
+
+static const struct file_operations dmabuf_move_test_fops = {
+	.owner = THIS_MODULE,
+	.open = dmabuf_move_test_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+int
+dummygfx_dmabuf_test_init(struct dentry *root)
+{
+	struct dentry *d;
+
+	d = debugfs_create_file("dmabuf_kqueue_test", S_IRUSR, root, NULL,
+	    &dmabuf_kqueue_test_fops);
+	if (!d) {
+		DRM_ERROR("Cannot create debugfs dmabuf_kqueue_test\n");
+		return -ENOMEM;
+	}
+	d = debugfs_create_file("dmabuf_move_test", S_IRUSR, root, NULL,
+	    &dmabuf_move_test_fops);
+	if (!d) {
+		DRM_ERROR("Cannot create debugfs dmabuf_move_test\n");
+		return -ENOMEM;
+	}
+	return 0;
+}
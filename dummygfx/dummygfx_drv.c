@@ -47,6 +47,7 @@ LKPI_DRIVER_MODULE(dummygfx, dummygfx_init, dummygfx_exit);
 /* LKPI_PNP_INFO(pci, dummygfx, dummy_pci_id_list); */
 MODULE_DEPEND(dummygfx, drmn, 2, 2, 2);
 MODULE_DEPEND(dummygfx, ttm, 1, 1, 1);
+MODULE_DEPEND(dummygfx, dmabuf, 1, 1, 1);
 MODULE_DEPEND(dummygfx, agp, 1, 1, 1);
 MODULE_DEPEND(dummygfx, linuxkpi, 1, 1, 1);
 #ifdef CONFIG_DEBUG_FS
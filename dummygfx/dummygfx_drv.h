@@ -28,3 +28,6 @@
 
 int dummygfx_debugfs_init(void);
 void dummygfx_debugfs_exit(void);
+int dummygfx_bench_init(struct dentry *root);
+int dummygfx_sched_bench_init(struct dentry *root);
+int dummygfx_dmabuf_test_init(struct dentry *root);
@@ -0,0 +1,533 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice unmodified, this list of conditions, and the following
+ *    disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * drm_sched throughput benchmark on null hardware
+ *
+ * A drm_gpu_scheduler whose run_job() hands out software fences.  A ring
+ * kthread signals them in order once each has been "executing" for
+ * sched_bench_latency_us after the one before it, the way a ring works
+ * through its queue.  sched_bench_producers kthreads each own
+ * sched_bench_entities entities and push sched_bench_jobs jobs round
+ * robin over them, keeping at most sched_bench_inflight jobs outstanding.
+ *
+ *	cat /sys/kernel/debug/dummygfx/sched_bench
+ *
+ * reports jobs/s, the doorbells rung by flush_jobs(), the cost of arming
+ * and pushing a job, the cost of signalling a hardware fence (which runs
+ * the scheduler's fence callbacks), the queue latency from push to
+ * run_job() and how often the run queue locks were contended.
+ */
+
+#include <sys/param.h>
+#include <sys/systm.h>
+
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <linux/delay.h>
+#include <linux/dma-fence.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/wait.h>
+
+#include <drm/gpu_scheduler.h>
+
+#include "dummygfx_drv.h"
+
+static unsigned int sched_bench_producers = 4;
+module_param_named(sched_bench_producers, sched_bench_producers, uint, 0644);
+MODULE_PARM_DESC(sched_bench_producers, "Submitting threads used by sched_bench");
+
+static unsigned int sched_bench_entities = 8;
+module_param_named(sched_bench_entities, sched_bench_entities, uint, 0644);
+MODULE_PARM_DESC(sched_bench_entities, "Entities owned by each sched_bench thread");
+
+static unsigned int sched_bench_jobs = 10000;
+module_param_named(sched_bench_jobs, sched_bench_jobs, uint, 0644);
+MODULE_PARM_DESC(sched_bench_jobs, "Jobs pushed by each sched_bench thread");
+
+static unsigned int sched_bench_inflight = 64;
+module_param_named(sched_bench_inflight, sched_bench_inflight, uint, 0644);
+MODULE_PARM_DESC(sched_bench_inflight, "Unfinished jobs allowed per sched_bench thread");
+
+static unsigned int sched_bench_latency_us = 10;
+module_param_named(sched_bench_latency_us, sched_bench_latency_us, uint, 0644);
+MODULE_PARM_DESC(sched_bench_latency_us, "Execution time of a sched_bench job on the null hardware");
+
+static unsigned int sched_bench_hw_submission = 2;
+module_param_named(sched_bench_hw_submission, sched_bench_hw_submission, uint, 0644);
+MODULE_PARM_DESC(sched_bench_hw_submission, "Jobs the sched_bench scheduler keeps on the null hardware");
+
+static unsigned int sched_bench_batch = 1;
+module_param_named(sched_bench_batch, sched_bench_batch, uint, 0644);
+MODULE_PARM_DESC(sched_bench_batch, "Jobs the sched_bench scheduler may dispatch per wakeup");
+
+static int sched_bench_policy = DRM_SCHED_POLICY_DEFAULT;
+module_param_named(sched_bench_policy, sched_bench_policy, int, 0644);
+MODULE_PARM_DESC(sched_bench_policy, "Run queue policy of the sched_bench scheduler (0 = drm default, 1 = round robin, 2 = virtual runtime)");
+
+static DEFINE_MUTEX(sched_bench_lock);
+
+struct null_hw_fence {
+	struct dma_fence	base;
+	struct list_head	link;
+	ktime_t			deadline;
+};
+
+struct sched_bench {
+	struct drm_gpu_scheduler sched;
+
+	/*
+	 * The null hardware, fences in the order run_job() queued them.
+	 * They are staged until flush_jobs() rings the doorbell.
+	 */
+	spinlock_t		fence_lock;
+	spinlock_t		ring_lock;
+	struct list_head	staged;
+	struct list_head	ring;
+	u64			doorbells;
+	wait_queue_head_t	ring_wq;
+	struct task_struct	*ring_thread;
+	u64			fence_context;
+	u64			seqno;
+	ktime_t			last_deadline;
+	u64			latency_ns;
+	u64			signal_ns;
+	u64			signals;
+
+	/* Parameters of this run. */
+	unsigned int		nentities;
+	unsigned int		jobs;
+	unsigned int		inflight;
+
+	/* Jobs not freed yet, producers wait on done_wq for this and room. */
+	atomic_t		pending;
+	wait_queue_head_t	done_wq;
+	atomic64_t		push_ns;
+
+	/* Push to run_job() delay of each job, in the order freed. */
+	u64			*queue_ns;
+	unsigned int		total;
+	atomic_t		nsamples;
+};
+
+struct sched_bench_producer {
+	struct sched_bench	*bench;
+	struct drm_sched_entity	*entities;
+	struct task_struct	*thread;
+	struct completion	done;
+	atomic_t		inflight;
+	int			error;
+};
+
+struct sched_bench_job {
+	struct drm_sched_job	base;
+	struct sched_bench_producer *producer;
+};
+
+static const char *
+null_hw_fence_get_driver_name(struct dma_fence *fence)
+{
+
+	return ("dummygfx");
+}
+
+static const char *
+null_hw_fence_get_timeline_name(struct dma_fence *fence)
+{
+
+	return ("null_hw");
+}
+
+static const struct dma_fence_ops null_hw_fence_ops = {
+	.get_driver_name = null_hw_fence_get_driver_name,
+	.get_timeline_name = null_hw_fence_get_timeline_name,
+};
+
+static int
+null_hw_ring_fn(void *arg)
+{
+	struct sched_bench *b = arg;
+	struct null_hw_fence *f;
+	s64 delay;
+	u64 t;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(b->ring_wq,
+		    !list_empty(&b->ring) || kthread_should_stop());
+
+		spin_lock(&b->ring_lock);
+		f = list_first_entry_or_null(&b->ring, struct null_hw_fence,
+		    link);
+		if (f != NULL)
+			list_del(&f->link);
+		spin_unlock(&b->ring_lock);
+		if (f == NULL)
+			continue;
+
+		delay = ktime_us_delta(f->deadline, ktime_get());
+		if (delay > 0)
+			usleep_range(delay, delay);
+
+		t = ktime_get_ns();
+		dma_fence_signal(&f->base);
+		b->signal_ns += ktime_get_ns() - t;
+		b->signals++;
+		dma_fence_put(&f->base);
+	}
+
+	return (0);
+}
+
+static struct dma_fence *
+null_hw_run_job(struct drm_sched_job *sched_job)
+{
+	struct sched_bench *b =
+	    container_of(sched_job->sched, struct sched_bench, sched);
+	struct null_hw_fence *f;
+	ktime_t now;
+
+	f = kzalloc(sizeof(*f), GFP_KERNEL);
+	if (f == NULL)
+		return (ERR_PTR(-ENOMEM));
+	dma_fence_init(&f->base, &null_hw_fence_ops, &b->fence_lock,
+	    b->fence_context, ++b->seqno);
+
+	/* Starts once the job ahead of it is done. */
+	now = ktime_get();
+	if (ktime_before(b->last_deadline, now))
+		b->last_deadline = now;
+	b->last_deadline = ktime_add_ns(b->last_deadline, b->latency_ns);
+	f->deadline = b->last_deadline;
+
+	/* One reference for the ring, one returned to the scheduler. */
+	dma_fence_get(&f->base);
+	list_add_tail(&f->link, &b->staged);
+
+	return (&f->base);
+}
+
+static void
+null_hw_flush_jobs(struct drm_gpu_scheduler *sched)
+{
+	struct sched_bench *b = container_of(sched, struct sched_bench, sched);
+
+	spin_lock(&b->ring_lock);
+	list_splice_tail_init(&b->staged, &b->ring);
+	spin_unlock(&b->ring_lock);
+	b->doorbells++;
+	wake_up(&b->ring_wq);
+}
+
+static enum drm_gpu_sched_stat
+null_hw_timedout_job(struct drm_sched_job *sched_job)
+{
+
+	return (DRM_GPU_SCHED_STAT_NOMINAL);
+}
+
+static void
+null_hw_free_job(struct drm_sched_job *sched_job)
+{
+	struct sched_bench_job *job =
+	    container_of(sched_job, struct sched_bench_job, base);
+	struct sched_bench_producer *p = job->producer;
+	struct sched_bench *b = p->bench;
+	unsigned int i;
+
+	i = atomic_inc_return(&b->nsamples) - 1;
+	if (i < b->total)
+		b->queue_ns[i] = ktime_to_ns(ktime_sub(sched_job->lat_run,
+		    sched_job->lat_submit));
+
+	drm_sched_job_cleanup(sched_job);
+	kfree(job);
+
+	atomic_dec(&p->inflight);
+	atomic_dec(&b->pending);
+	wake_up_all(&b->done_wq);
+}
+
+static const struct drm_sched_backend_ops null_hw_sched_ops = {
+	.run_job = null_hw_run_job,
+	.timedout_job = null_hw_timedout_job,
+	.free_job = null_hw_free_job,
+	.flush_jobs = null_hw_flush_jobs,
+};
+
+static int
+sched_bench_producer_fn(void *arg)
+{
+	struct sched_bench_producer *p = arg;
+	struct sched_bench *b = p->bench;
+	struct sched_bench_job *job;
+	unsigned int i;
+	u64 t;
+
+	for (i = 0; i < b->jobs; i++) {
+		wait_event(b->done_wq, atomic_read(&p->inflight) < b->inflight);
+
+		job = kzalloc(sizeof(*job), GFP_KERNEL);
+		if (job == NULL) {
+			p->error = -ENOMEM;
+			break;
+		}
+		job->producer = p;
+		p->error = drm_sched_job_init(&job->base,
+		    &p->entities[i % b->nentities], NULL);
+		if (p->error != 0) {
+			kfree(job);
+			break;
+		}
+		atomic_inc(&p->inflight);
+
+		t = ktime_get_ns();
+		drm_sched_job_arm(&job->base);
+		drm_sched_entity_push_job(&job->base);
+		atomic64_add(ktime_get_ns() - t, &b->push_ns);
+	}
+
+	/* Jobs never pushed are done as far as the benchmark goes. */
+	if (i < b->jobs) {
+		atomic_sub(b->jobs - i, &b->pending);
+		wake_up_all(&b->done_wq);
+	}
+	complete(&p->done);
+
+	/* Stay around for kthread_stop(). */
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return (0);
+}
+
+static int
+sched_bench_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return (x < y ? -1 : x > y);
+}
+
+static void
+sched_bench_report(struct seq_file *m, struct sched_bench *b, u64 elapsed)
+{
+	unsigned long count, contended;
+	unsigned int n;
+	int i;
+
+	n = min_t(unsigned int, atomic_read(&b->nsamples), b->total);
+	seq_printf(m, "%-14s %10u jobs %12llu ns %10llu jobs/s\n", "throughput",
+	    n, (unsigned long long)elapsed,
+	    (unsigned long long)(elapsed ? div64_u64((u64)n * NSEC_PER_SEC,
+	    elapsed) : 0));
+	seq_printf(m, "%-14s %10llu ns/job\n", "arm+push",
+	    (unsigned long long)(n ? div64_u64(atomic64_read(&b->push_ns), n) :
+	    0));
+	seq_printf(m, "%-14s %10llu doorbells %llu jobs/doorbell\n",
+	    "dispatch", (unsigned long long)b->doorbells,
+	    (unsigned long long)(b->doorbells ?
+	    div64_u64(b->signals, b->doorbells) : 0));
+	seq_printf(m, "%-14s %10llu ns/fence\n", "fence signal",
+	    (unsigned long long)(b->signals ?
+	    div64_u64(b->signal_ns, b->signals) : 0));
+
+	if (n != 0) {
+		sort(b->queue_ns, n, sizeof(*b->queue_ns),
+		    sched_bench_cmp_u64, NULL);
+		seq_printf(m, "%-14s p50 %llu p99 %llu max %llu us\n",
+		    "queue latency",
+		    (unsigned long long)div64_u64(b->queue_ns[n / 2],
+		    NSEC_PER_USEC),
+		    (unsigned long long)div64_u64(b->queue_ns[
+		    (u64)n * 99 / 100], NSEC_PER_USEC),
+		    (unsigned long long)div64_u64(b->queue_ns[n - 1],
+		    NSEC_PER_USEC));
+	}
+
+	count = contended = 0;
+	for (i = DRM_SCHED_PRIORITY_MIN; i < DRM_SCHED_PRIORITY_COUNT; i++) {
+		count += b->sched.sched_rq[i].lock_count;
+		contended += b->sched.sched_rq[i].lock_contended;
+	}
+	seq_printf(m, "%-14s %10lu taken %10lu contended (%lu.%02lu%%)\n",
+	    "rq->lock", count, contended,
+	    count ? contended * 100 / count : 0,
+	    count ? contended * 10000 / count % 100 : 0);
+}
+
+static int
+sched_bench_show(struct seq_file *m, void *unused)
+{
+	struct drm_gpu_scheduler *sched_list[1];
+	struct sched_bench_producer *producers;
+	struct drm_sched_entity *entities;
+	struct sched_bench *b;
+	unsigned int nprod, nent, i, j;
+	u64 t;
+	int ret;
+
+	mutex_lock(&sched_bench_lock);
+
+	nprod = max(sched_bench_producers, 1u);
+	nent = max(sched_bench_entities, 1u);
+
+	b = kzalloc(sizeof(*b), GFP_KERNEL);
+	producers = kcalloc(nprod, sizeof(*producers), GFP_KERNEL);
+	entities = kcalloc(nprod * nent, sizeof(*entities), GFP_KERNEL);
+	if (b == NULL || producers == NULL || entities == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	b->nentities = nent;
+	b->jobs = sched_bench_jobs;
+	b->inflight = max(sched_bench_inflight, 1u);
+	b->total = nprod * b->jobs;
+	b->queue_ns = kvcalloc(max(b->total, 1u), sizeof(*b->queue_ns),
+	    GFP_KERNEL);
+	if (b->queue_ns == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	spin_lock_init(&b->fence_lock);
+	spin_lock_init(&b->ring_lock);
+	INIT_LIST_HEAD(&b->staged);
+	INIT_LIST_HEAD(&b->ring);
+	init_waitqueue_head(&b->ring_wq);
+	init_waitqueue_head(&b->done_wq);
+	b->fence_context = dma_fence_context_alloc(1);
+	b->latency_ns = (u64)sched_bench_latency_us * NSEC_PER_USEC;
+	atomic_set(&b->pending, b->total);
+
+	b->ring_thread = kthread_run(null_hw_ring_fn, b, "null_hw");
+	if (IS_ERR(b->ring_thread)) {
+		ret = PTR_ERR(b->ring_thread);
+		goto out;
+	}
+
+	ret = drm_sched_init(&b->sched, &null_hw_sched_ops,
+	    max(sched_bench_hw_submission, 1u), 0, MAX_SCHEDULE_TIMEOUT, NULL,
+	    NULL, "null_hw", NULL, sched_bench_policy);
+	if (ret != 0)
+		goto stop_ring;
+	WRITE_ONCE(b->sched.dispatch_batch, max(sched_bench_batch, 1u));
+
+	sched_list[0] = &b->sched;
+	for (i = 0; i < nprod * nent; i++) {
+		ret = drm_sched_entity_init(&entities[i],
+		    DRM_SCHED_PRIORITY_NORMAL, sched_list, 1, NULL);
+		if (ret != 0)
+			goto fini_entities;
+	}
+
+	seq_printf(m, "sched: %s, %u threads x %u entities, %u jobs each, "
+	    "%u in flight, %uus on %u hw slots, batch %u\n",
+	    b->sched.policy == DRM_SCHED_POLICY_VRUNTIME ? "vruntime" : "rr",
+	    nprod, nent, b->jobs, b->inflight,
+	    sched_bench_latency_us, b->sched.hw_submission_limit,
+	    b->sched.dispatch_batch);
+
+	t = ktime_get_ns();
+	for (j = 0; j < nprod; j++) {
+		producers[j].bench = b;
+		producers[j].entities = &entities[j * nent];
+		init_completion(&producers[j].done);
+		atomic_set(&producers[j].inflight, 0);
+		producers[j].thread = kthread_run(sched_bench_producer_fn,
+		    &producers[j], "sched_bench");
+		if (IS_ERR(producers[j].thread)) {
+			ret = PTR_ERR(producers[j].thread);
+			atomic_sub(b->jobs, &b->pending);
+			producers[j].thread = NULL;
+		}
+	}
+	wait_event(b->done_wq, atomic_read(&b->pending) == 0);
+	t = ktime_get_ns() - t;
+
+	for (j = 0; j < nprod; j++) {
+		if (producers[j].thread == NULL)
+			continue;
+		wait_for_completion(&producers[j].done);
+		kthread_stop(producers[j].thread);
+		if (producers[j].error != 0)
+			ret = producers[j].error;
+	}
+
+	if (ret != 0)
+		seq_printf(m, "sched: submission failed: %d\n", ret);
+	sched_bench_report(m, b, t);
+
+fini_entities:
+	while (i-- > 0)
+		drm_sched_entity_destroy(&entities[i]);
+	drm_sched_fini(&b->sched);
+stop_ring:
+	kthread_stop(b->ring_thread);
+out:
+	if (b != NULL)
+		kvfree(b->queue_ns);
+	kfree(entities);
+	kfree(producers);
+	kfree(b);
+	mutex_unlock(&sched_bench_lock);
+	return (ret);
+}
+
+static int
+sched_bench_open(struct inode *inode, struct file *file)
+{
+
+	return single_open(file, sched_bench_show, inode->i_private);
+}
+
+static const struct file_operations sched_bench_fops = {
+	.owner = THIS_MODULE,
+	.open = sched_bench_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+int
+dummygfx_sched_bench_init(struct dentry *root)
+{
+	struct dentry *d;
+
+	d = debugfs_create_file("sched_bench", S_IRUSR, root, NULL,
+	    &sched_bench_fops);
+	if (!d) {
+		DRM_ERROR("Cannot create debugfs sched_bench\n");
+		return -ENOMEM;
+	}
+	return 0;
+}
@@ -360,6 +360,17 @@ struct drm_file {
 	 */
 	int event_space;
 
+#ifdef __FreeBSD__
+	/**
+	 * @event_pending:
+	 *
+	 * Bytes of events on @event_list, reported by FIONREAD.
+	 *
+	 * Protect by &drm_device.event_lock.
+	 */
+	int event_pending;
+#endif
+
 	/** @event_read_lock: Serializes drm_read(). */
 	struct mutex event_read_lock;
 
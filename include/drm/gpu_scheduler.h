@@ -27,6 +27,7 @@
 #include <drm/spsc_queue.h>
 #include <linux/dma-fence.h>
 #include <linux/completion.h>
+#include <linux/rbtree.h>
 #include <linux/xarray.h>
 #include <linux/workqueue.h>
 
@@ -46,6 +47,52 @@ struct drm_gem_object;
 struct drm_gpu_scheduler;
 struct drm_sched_rq;
 
+#ifdef __FreeBSD__
+struct drm_printer;
+
+/*
+ * Log2 latency histograms kept per scheduler and per entity.  Bucket i
+ * counts intervals shorter than 2^i microseconds, the last bucket also
+ * counts everything longer.
+ */
+#define	DRM_SCHED_LAT_BUCKETS	24
+
+enum drm_sched_lat_type {
+	DRM_SCHED_LAT_QUEUE,	/* drm_sched_entity_push_job() to run_job() */
+	DRM_SCHED_LAT_HW,	/* run_job() to drm_sched_job_done() */
+	DRM_SCHED_LAT_DEP,	/* blocked on a dependency fence */
+	DRM_SCHED_LAT_COUNT
+};
+
+/**
+ * struct drm_sched_lat - latency histograms of a scheduler or an entity
+ *
+ * Listed for drm_sched_lat_print() from drm_sched_init() and
+ * drm_sched_entity_init() until the matching fini.  The entity copy is
+ * allocated separately and referenced by its jobs, so that jobs still on
+ * the hardware can account for their completion after the entity is gone.
+ */
+struct drm_sched_lat {
+	struct list_head	link;
+	struct kref		refcount;
+	struct device		*dev;
+	const char		*name;
+	bool			entity;
+	pid_t			pid;
+	char			comm[MAXCOMLEN + 1];
+	u_long			hist[DRM_SCHED_LAT_COUNT][DRM_SCHED_LAT_BUCKETS];
+};
+
+void drm_sched_lat_init(struct drm_sched_lat *lat, struct device *dev,
+			const char *name, bool entity);
+void drm_sched_lat_fini(struct drm_sched_lat *lat);
+void drm_sched_lat_put(struct drm_sched_lat *lat);
+void drm_sched_lat_account(struct drm_sched_lat *lat,
+			   enum drm_sched_lat_type type, ktime_t start,
+			   ktime_t end);
+void drm_sched_lat_print(struct drm_printer *p, struct device *dev);
+#endif
+
 /* These are often used as an (initial) index
  * to an array, and as such should start at 0.
  */
@@ -59,6 +106,33 @@ enum drm_sched_priority {
 	DRM_SCHED_PRIORITY_UNSET = -2
 };
 
+/**
+ * enum drm_sched_policy - how a run queue picks the next entity
+ *
+ * @DRM_SCHED_POLICY_DEFAULT: use the sched_policy module parameter
+ * @DRM_SCHED_POLICY_RR: round robin over the entities of the run queue
+ * @DRM_SCHED_POLICY_VRUNTIME: entity with the least GPU time charged to it,
+ *			       kept in an rbtree keyed on &drm_sched_entity.vruntime
+ */
+enum drm_sched_policy {
+	DRM_SCHED_POLICY_DEFAULT,
+	DRM_SCHED_POLICY_RR,
+	DRM_SCHED_POLICY_VRUNTIME,
+	DRM_SCHED_POLICY_COUNT,
+};
+
+/**
+ * struct drm_sched_entity_stats - GPU time used by an entity
+ *
+ * @refcount: held by the entity and by each of its jobs until
+ *	      drm_sched_job_cleanup(), jobs can outlive their entity.
+ * @runtime: nanoseconds of GPU time of the completed jobs.
+ */
+struct drm_sched_entity_stats {
+	struct kref			refcount;
+	atomic64_t			runtime;
+};
+
 /**
  * struct drm_sched_entity - A wrapper around a job queue (typically
  * attached to the DRM file_priv).
@@ -205,6 +279,47 @@ struct drm_sched_entity {
 	 * drm_sched_entity_fini().
 	 */
 	struct completion		entity_idle;
+
+	/**
+	 * @rb_node:
+	 *
+	 * Node in &drm_sched_rq.rb_root while the entity is ready, i.e. has
+	 * queued jobs and no pending dependency, on a run queue using
+	 * &DRM_SCHED_POLICY_VRUNTIME.
+	 *
+	 * Protected by &drm_sched_rq.lock of @rq.
+	 */
+	struct rb_node			rb_node;
+
+	/**
+	 * @vruntime:
+	 *
+	 * Key of @rb_node, the GPU time in nanoseconds charged to this entity,
+	 * never behind &drm_sched_rq.min_vruntime when (re)inserted and
+	 * rebased onto it when the entity moves to another run queue.
+	 *
+	 * Protected by &drm_sched_rq.lock of @rq.
+	 */
+	u64				vruntime;
+
+	/** @runtime_seen: part of @stats already added to @vruntime */
+	u64				runtime_seen;
+
+	/**
+	 * @stats:
+	 *
+	 * GPU time of the jobs of this entity, only allocated when the entity
+	 * is created on a scheduler using &DRM_SCHED_POLICY_VRUNTIME.
+	 */
+	struct drm_sched_entity_stats	*stats;
+
+#ifdef __FreeBSD__
+	/** @lat: latency histograms of this entity */
+	struct drm_sched_lat		*lat;
+
+	/** @lat_dep_start: when the entity started waiting for @dependency */
+	ktime_t				lat_dep_start;
+#endif
 };
 
 /**
@@ -214,6 +329,12 @@ struct drm_sched_entity {
  * @sched: the scheduler to which this rq belongs to.
  * @entities: list of the entities to be scheduled.
  * @current_entity: the entity which is to be scheduled.
+ * @rb_root: ready entities ordered by vruntime, for
+ *	     &DRM_SCHED_POLICY_VRUNTIME.
+ * @min_vruntime: vruntime of the last entity selected, entities joining
+ *		  @rb_root start no earlier so that idling earns no credit.
+ * @lock_count: times the scheduler took @lock (FreeBSD).
+ * @lock_contended: times out of @lock_count that had to wait (FreeBSD).
  *
  * Run queue is a set of entities scheduling command submissions for
  * one specific ring. It implements the scheduling policy that selects
@@ -224,6 +345,12 @@ struct drm_sched_rq {
 	struct drm_gpu_scheduler	*sched;
 	struct list_head		entities;
 	struct drm_sched_entity		*current_entity;
+	struct rb_root_cached		rb_root;
+	u64				min_vruntime;
+#ifdef __FreeBSD__
+	unsigned long			lock_count;
+	unsigned long			lock_contended;
+#endif
 };
 
 /**
@@ -323,6 +450,22 @@ struct drm_sched_job {
 
 	/** @last_dependency: tracks @dependencies as they signal */
 	unsigned long			last_dependency;
+
+	/**
+	 * @entity_stats: GPU time of the entity the job was pushed to,
+	 * referenced until drm_sched_job_cleanup().
+	 */
+	struct drm_sched_entity_stats	*entity_stats;
+
+	/** @start_time: when run_job() handed the job to the hardware */
+	ktime_t				start_time;
+
+#ifdef __FreeBSD__
+	/* entity histograms, referenced from push until completion */
+	struct drm_sched_lat		*lat;
+	ktime_t				lat_submit;
+	ktime_t				lat_run;
+#endif
 };
 
 static inline bool drm_sched_invalidate_job(struct drm_sched_job *s_job,
@@ -415,6 +558,14 @@ struct drm_sched_backend_ops {
          * and it's time to clean it up.
 	 */
 	void (*free_job)(struct drm_sched_job *sched_job);
+
+	/**
+	 * @flush_jobs: Optional, called after a batch of run_job() calls
+	 * made in one pass, see &drm_gpu_scheduler.dispatch_batch.  Drivers
+	 * can leave the ring write pointer alone in run_job() and update it
+	 * once here.
+	 */
+	void (*flush_jobs)(struct drm_gpu_scheduler *sched);
 };
 
 /**
@@ -445,6 +596,14 @@ struct drm_sched_backend_ops {
  * @ready: marks if the underlying HW is ready to work
  * @free_guilty: A hit to time out handler to free the guilty job.
  * @dev: system &struct device
+ * @policy: how the run queues pick entities, see &enum drm_sched_policy.
+ * @last_done: completion time of the last job, jobs queued behind it only
+ *	       start using the hardware from there.
+ * @dispatch_batch: jobs the scheduler thread may run per wakeup before
+ *		    calling &drm_sched_backend_ops.flush_jobs, set from the
+ *		    sched_dispatch_batch module parameter by drm_sched_init()
+ *		    and may be changed by the driver at any time.
+ * @lat: latency histograms of this scheduler (FreeBSD)
  *
  * One scheduler is implemented for each hardware ring.
  */
@@ -469,13 +628,20 @@ struct drm_gpu_scheduler {
 	bool				ready;
 	bool				free_guilty;
 	struct device			*dev;
+	enum drm_sched_policy		policy;
+	ktime_t				last_done;
+	unsigned int			dispatch_batch;
+#ifdef __FreeBSD__
+	struct drm_sched_lat		lat;
+#endif
 };
 
 int drm_sched_init(struct drm_gpu_scheduler *sched,
 		   const struct drm_sched_backend_ops *ops,
 		   uint32_t hw_submission, unsigned hang_limit,
 		   long timeout, struct workqueue_struct *timeout_wq,
-		   atomic_t *score, const char *name, struct device *dev);
+		   atomic_t *score, const char *name, struct device *dev,
+		   enum drm_sched_policy policy);
 
 void drm_sched_fini(struct drm_gpu_scheduler *sched);
 int drm_sched_job_init(struct drm_sched_job *job,
@@ -511,6 +677,9 @@ void drm_sched_rq_add_entity(struct drm_sched_rq *rq,
 			     struct drm_sched_entity *entity);
 void drm_sched_rq_remove_entity(struct drm_sched_rq *rq,
 				struct drm_sched_entity *entity);
+void drm_sched_rq_update_entity(struct drm_sched_rq *rq,
+				struct drm_sched_entity *entity);
+void drm_sched_entity_stats_put(struct drm_sched_entity_stats *stats);
 
 int drm_sched_entity_init(struct drm_sched_entity *entity,
 			  enum drm_sched_priority priority,
@@ -97,6 +97,9 @@ struct ttm_tt;
  * @offset: The current GPU offset, which can have different meanings
  * depending on the memory type. For SYSTEM type memory, it should be 0.
  * @cur_placement: Hint of current placement.
+ * @fault_next: Page offset right behind the pages mapped by the last CPU
+ * page fault.
+ * @fault_window: Number of pages the last CPU page fault tried to map.
  *
  * Base class for TTM buffer object, that deals with data placement and CPU
  * mappings. GPU mappings are really up to the driver, but for simpler GPUs
@@ -148,6 +151,10 @@ struct ttm_buffer_object {
 
 	unsigned priority;
 	unsigned pin_count;
+#ifdef __FreeBSD__
+	pgoff_t fault_next;
+	pgoff_t fault_window;
+#endif
 
 	/**
 	 * Special members that are protected by the reserve lock
@@ -29,6 +29,9 @@
 #include <linux/mmzone.h>
 #include <linux/llist.h>
 #include <linux/spinlock.h>
+#ifdef __FreeBSD__
+#include <linux/xarray.h>
+#endif
 #include <drm/ttm/ttm_caching.h>
 
 struct device;
@@ -44,7 +47,8 @@ struct ttm_operation_ctx;
  * @caching: the caching type our pages have
  * @shrinker_list: our place on the global shrinker list
  * @lock: protection of the page list
- * @pages: the list of pages in the pool
+ * @pages: the list of pages in the pool, one per memory domain on FreeBSD
+ * @dirty: per memory domain lists of pages not yet zeroed (FreeBSD only)
  */
 struct ttm_pool_type {
 	struct ttm_pool *pool;
@@ -57,7 +61,8 @@ struct ttm_pool_type {
 #ifdef __linux__
 	struct list_head pages;
 #elif defined(__FreeBSD__)
-	struct pglist pages;
+	struct pglist pages[MAXMEMDOM];
+	struct pglist dirty[MAXMEMDOM];
 #endif
 };
 
@@ -68,6 +73,8 @@ struct ttm_pool_type {
  * @use_dma_alloc: if coherent DMA allocations should be used
  * @use_dma32: if GFP_DMA32 should be used
  * @caching: pools for each caching/order
+ * @dma_pages: coherent DMA allocations indexed by pfn (FreeBSD only)
+ * @domain: memory domain of the device or -1 if unknown (FreeBSD only)
  */
 struct ttm_pool {
 	struct device *dev;
@@ -78,6 +85,10 @@ struct ttm_pool {
 	struct {
 		struct ttm_pool_type orders[MAX_ORDER];
 	} caching[TTM_NUM_CACHING_TYPES];
+#ifdef __FreeBSD__
+	struct xarray dma_pages;
+	int domain;
+#endif
 };
 
 int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
@@ -48,9 +48,11 @@ struct ttm_tt {
 	struct page **pages;
 #ifdef __FreeBSD__
 	/* On Linux, `struct page` has a private field. It is used by
-	 * `ttm_pool` to store private data. FreeBSD's `struct vm_page` does
-	 * not have that, so we use an extra field in `struct ttm_tt` */
-	unsigned int *orders;
+	 * `ttm_pool` to store the allocation order. FreeBSD's `struct vm_page`
+	 * does not have that, so we keep a bitmap in `struct ttm_tt` with one
+	 * bit set for the first page of every allocation; the order follows
+	 * from the distance to the next one. */
+	unsigned long *chunks;
 #endif
 	/**
 	 * @page_flags: The page flags.
@@ -29,6 +29,7 @@ KCONFIG+=	DRM_FBDEV_EMULATION \
 KCONFIG+=	ARCH_HAVE_NMI_SAFE_CMPXCHG \
 		BACKLIGHT_CLASS_DEVICE \
 		DEBUG_FS \
+		DMABUF_MOVE_NOTIFY \
 		DMI \
 		FB \
 		MTRR \
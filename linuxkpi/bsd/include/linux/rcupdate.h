@@ -0,0 +1,34 @@
+#ifndef _BSD_LKPI_LINUX_RCUPDATE_H_
+#define	_BSD_LKPI_LINUX_RCUPDATE_H_
+
+#include <sys/types.h>
+#include <machine/atomic.h>
+
+#include_next <linux/rcupdate.h>
+
+#ifndef get_state_synchronize_rcu
+/*
+ * Polled grace-period cookies, implemented in dma-buf-kmod.c.
+ *
+ * Grace periods are numbered in the order they are started and a cookie
+ * is the number of the last one started when it was taken.  It expires
+ * once any later numbered grace period has completed.
+ */
+extern volatile u_long lkpi_rcu_gp_completed;
+
+unsigned long lkpi_get_state_synchronize_rcu(void);
+void lkpi_cond_synchronize_rcu(unsigned long cookie);
+
+static inline bool
+lkpi_poll_state_synchronize_rcu(unsigned long cookie)
+{
+	return ((long)(atomic_load_acq_long(&lkpi_rcu_gp_completed) -
+	    cookie) > 0);
+}
+
+#define	get_state_synchronize_rcu()	lkpi_get_state_synchronize_rcu()
+#define	poll_state_synchronize_rcu(c)	lkpi_poll_state_synchronize_rcu(c)
+#define	cond_synchronize_rcu(c)		lkpi_cond_synchronize_rcu(c)
+#endif
+
+#endif /* _BSD_LKPI_LINUX_RCUPDATE_H_ */
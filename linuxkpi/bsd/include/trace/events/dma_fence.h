@@ -31,45 +31,73 @@
 
 #include <sys/param.h>
 #include <sys/ktr.h>
+#include <sys/sdt.h>
+
+#include <linux/dma-fence.h>
 
 #ifndef KTR_DRM
 #define	KTR_DRM	KTR_DEV
 #endif
 
+/*
+ * drm:dma_fence:: probes, defined in dma-fence.c.  Arguments follow the
+ * Linux dma_fence event class: fence, driver name, timeline name, context
+ * and seqno.
+ */
+SDT_PROVIDER_DECLARE(drm);
+SDT_PROBE_DECLARE(drm, dma_fence, , init);
+SDT_PROBE_DECLARE(drm, dma_fence, , destroy);
+SDT_PROBE_DECLARE(drm, dma_fence, , enable_signal);
+SDT_PROBE_DECLARE(drm, dma_fence, , signaled);
+SDT_PROBE_DECLARE(drm, dma_fence, , wait_start);
+SDT_PROBE_DECLARE(drm, dma_fence, , wait_end);
+
+#define	DMA_FENCE_SDT_PROBE(name, fence)				\
+	SDT_PROBE5(drm, dma_fence, , name, (fence),			\
+	    (fence)->ops->get_driver_name(fence),			\
+	    (fence)->ops->get_timeline_name(fence),			\
+	    (fence)->context, (fence)->seqno)
+
 static inline void
-trace_dma_fence_init(void *fence)
+trace_dma_fence_init(struct dma_fence *fence)
 {
 	CTR1(KTR_DRM, "dma_fence_init dma_fence %p", fence);
+	DMA_FENCE_SDT_PROBE(init, fence);
 }
 
 static inline void
-trace_dma_fence_destroy(void *fence)
+trace_dma_fence_destroy(struct dma_fence *fence)
 {
 	CTR1(KTR_DRM, "dma_fence_destroy dma_fence %p", fence);
+	DMA_FENCE_SDT_PROBE(destroy, fence);
 }
 
 static inline void
-trace_dma_fence_enable_signal(void *fence)
+trace_dma_fence_enable_signal(struct dma_fence *fence)
 {
 	CTR1(KTR_DRM, "dma_fence_enable_signal dma_fence %p", fence);
+	DMA_FENCE_SDT_PROBE(enable_signal, fence);
 }
 
 static inline void
-trace_dma_fence_signaled(void *fence)
+trace_dma_fence_signaled(struct dma_fence *fence)
 {
 	CTR1(KTR_DRM, "dma_fence_signaled dma_fence %p", fence);
+	DMA_FENCE_SDT_PROBE(signaled, fence);
 }
 
 static inline void
-trace_dma_fence_wait_start(void *fence)
+trace_dma_fence_wait_start(struct dma_fence *fence)
 {
 	CTR1(KTR_DRM, "dma_fence_wait_start dma_fence %p", fence);
+	DMA_FENCE_SDT_PROBE(wait_start, fence);
 }
 
 static inline void
-trace_dma_fence_wait_end(void *fence)
+trace_dma_fence_wait_end(struct dma_fence *fence)
 {
 	CTR1(KTR_DRM, "dma_fence_wait_end dma_fence %p", fence);
+	DMA_FENCE_SDT_PROBE(wait_end, fence);
 }
 
 #endif
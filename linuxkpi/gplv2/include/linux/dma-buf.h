@@ -36,6 +36,10 @@
 #include <linux/wait.h>
 #include <linux/module.h>
 
+#include <sys/_mutex.h>
+#include <sys/_task.h>
+#include <sys/selinfo.h>
+
 struct device;
 struct dma_buf;
 struct dma_buf_attachment;
@@ -121,6 +125,9 @@ struct dma_buf {
 
 	/* poll support */
 	wait_queue_head_t poll;
+	struct mtx poll_lock;		/* protects the knotes of poll_sel */
+	struct selinfo poll_sel;
+	struct task poll_task;		/* runs after the poll callbacks */
 
 	struct dma_buf_poll_cb_t {
 		struct dma_fence_cb cb;
@@ -164,6 +171,21 @@ get_dma_buf(struct dma_buf *dmabuf)
 #endif
 }
 
+/*
+ * An exporter is dynamic when it can move its backing storage and an
+ * importer is dynamic when it can cope with that through move_notify.
+ */
+static inline bool
+dma_buf_is_dynamic(struct dma_buf *dmabuf)
+{
+	return (dmabuf->ops->pin != NULL);
+}
+
+static inline bool
+dma_buf_attachment_is_dynamic(struct dma_buf_attachment *attach)
+{
+	return (attach->importer_ops != NULL);
+}
 
 struct dma_buf_attachment *dma_buf_attach(struct dma_buf *, struct device *);
 struct dma_buf_attachment *dma_buf_dynamic_attach(struct dma_buf *,
@@ -149,6 +149,14 @@ struct linux_fb_info {
 	struct fb_info fbio;
 	device_t fb_bsddev;
 	struct task fb_mode_task;
+
+	/* Cached shadow of screen_base for the cfb_*() ops, see linux_fb.c */
+	uint8_t *fb_shadow;
+	size_t fb_shadow_size;
+	struct mtx fb_shadow_mtx;
+	struct timeout_task fb_shadow_task;
+	uint32_t fb_shadow_x1, fb_shadow_y1;	/* damage, protected by */
+	uint32_t fb_shadow_x2, fb_shadow_y2;	/* fb_shadow_mtx */
 #endif
 } __aligned(sizeof(long));
 
@@ -186,6 +194,7 @@ int remove_conflicting_framebuffers(struct apertures_struct *a,
 int remove_conflicting_pci_framebuffers(struct pci_dev *pdev, const char *name);
 struct linux_fb_info *framebuffer_alloc(size_t size, struct device *dev);
 void framebuffer_release(struct linux_fb_info *info);
+void linux_fb_shadow_flush(struct linux_fb_info *info);
 #define	fb_set_suspend(x, y)	0
 
 static inline bool